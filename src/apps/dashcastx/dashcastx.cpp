@@ -44,11 +44,18 @@ int safeMain(int argc, char const* argv[]) {
 #endif
 
 	dashcastXOptions opt = processArgs(argc, argv);
+	Modules::MemoryBudget::global().setLimit(opt.memoryBudgetInMB << 20);
+	if (!opt.tracePath.empty())
+		Modules::Tracing::start(opt.tracePath);
 
 	Tools::Profiler profilerGlobal("DashcastX");
 
 	auto pipeline = uptr(new Pipeline(opt.isLive));
 	declarePipeline(*pipeline, opt);
+	if (!opt.statsPath.empty()) {
+		auto const isPrometheus = opt.statsPath.size() > 5 && opt.statsPath.compare(opt.statsPath.size() - 5, 5, ".prom") == 0;
+		pipeline->setStatsDump(opt.statsPath, std::chrono::seconds(1), isPrometheus ? StatsPrometheus : StatsJsonLines);
+	}
 	g_Pipeline = pipeline.get();
 
 	Tools::Profiler profilerProcessing("DashcastX - processing time");
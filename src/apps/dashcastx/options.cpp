@@ -66,6 +66,9 @@ const option::Descriptor usage[] = {
 	{ OPT,     0, "l", "live",    Arg::None,    "  --live,          -l         \tRun at system clock pace (otherwise runs as fast as possible) with low latency settings (quality may be degraded)." },
 	{ NUMERIC, 0, "s", "seg-dur", Arg::Numeric, "  --seg-dur,       -s         \tSet the segment duration (in ms) (default value: 2000)." },
 	{ VIDEO,   0, "v", "video",   Arg::Video,   "  --video wxh[:b], -v wxh[:b] \tSet a video resolution and optionally bitrate (enables resize and/or transcoding)." },
+	{ NUMERIC, 0, "m", "memory-budget", Arg::Numeric, "  --memory-budget, -m         \tLimit the memory held by the allocators (in MB). Producers wait for memory when the limit is reached (default: unlimited)." },
+	{ NONEMPTY, 0, "t", "stats", Arg::NonEmpty, "  --stats file,    -t file    \tDump the module stats every second: JSON lines, or Prometheus text format when the file name ends with '.prom'." },
+	{ NONEMPTY, 0, "r", "trace", Arg::NonEmpty, "  --trace file,    -r file    \tTrace each data through the modules. Written on exit in the Chrome trace event format (Perfetto, chrome://tracing)." },
 	{
 		UNKNOWN, 0, "",  "",        Arg::None,
 		"\nExamples:\n"
@@ -95,6 +98,8 @@ void printDetectedOptions(option::Parser &parse, option::Option * const options)
 		std::cout << "Option: " << opt->name << ", value: " << atol(opt->arg) << std::endl;
 	for (option::Option* opt = options[VIDEO]; opt; opt = opt->next())
 		std::cout << "Option: " << opt->name << ", value: " << opt->arg << std::endl;
+	for (option::Option* opt = options[NONEMPTY]; opt; opt = opt->next())
+		std::cout << "Option: " << opt->name << ", value: " << opt->arg << std::endl;
 	for (option::Option* opt = options[OPT]; opt; opt = opt->next())
 		std::cout << "Option: " << opt->name << std::endl;
 	std::cout << std::endl;
@@ -123,8 +128,18 @@ dashcastXOptions processArgs(int argc, char const* argv[]) {
 	opt.url = parse.nonOption(0);
 	if (options[OPT].first()->desc && options[OPT].first()->desc->shortopt == std::string("l"))
 		opt.isLive = true;
-	if (options[NUMERIC].first()->desc && options[NUMERIC].first()->desc->shortopt == std::string("s"))
-		opt.segmentDuration = atol(options[NUMERIC].first()->arg);
+	for (option::Option* o = options[NUMERIC]; o; o = o->next()) {
+		if (o->desc && o->desc->shortopt == std::string("s"))
+			opt.segmentDuration = atol(o->arg);
+		else if (o->desc && o->desc->shortopt == std::string("m"))
+			opt.memoryBudgetInMB = atol(o->arg);
+	}
+	for (option::Option* o = options[NONEMPTY]; o; o = o->next()) {
+		if (o->desc && o->desc->shortopt == std::string("t"))
+			opt.statsPath = o->arg;
+		else if (o->desc && o->desc->shortopt == std::string("r"))
+			opt.tracePath = o->arg;
+	}
 	if (options[VIDEO].first()->desc && options[VIDEO].first()->desc->shortopt == std::string("v")) {
 		unsigned w=0, h=0, bitrate=0;
 		for (option::Option* o = options[VIDEO]; o; o = o->next()) {
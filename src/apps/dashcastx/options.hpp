@@ -12,6 +12,9 @@ struct dashcastXOptions {
 	std::string url;
 	std::vector<Video> v;
 	uint64_t segmentDuration = 2000;
+	uint64_t memoryBudgetInMB = 0;
+	std::string statsPath;
+	std::string tracePath;
 	bool isLive = false;
 };
 
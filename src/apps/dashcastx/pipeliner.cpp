@@ -101,6 +101,7 @@ void declarePipeline(Pipeline &pipeline, const dashcastXOptions &opt) {
 			auto muxer = pipeline.addModule<Mux::GPACMuxMP4>(filename.str(), opt.segmentDuration, true);
 			if (transcode) {
 				connect(encoder, muxer);
+				pipeline.fuse(muxer); //muxing is cheap: run it in the encoder thread
 			} else {
 				pipeline.connect(demux, i, muxer, 0);
 			}
@@ -265,6 +265,8 @@ void buildAVDictionary(const std::string &moduleName, AVDictionary **dict, const
 }
 
 void avLog(void* /*avcl*/, int level, const char *fmt, va_list vl) {
+	if (!Log::isEnabled(avLogLevel(level)))
+		return;
 #if defined(__CYGWIN__) // cygwin does not have vsnprintf in std=c++11 mode. To be removed when cygwin is fixed
 	Log::msg(avLogLevel(level), "[libav-log::%s] %s", avlogLevelName(level), fmt);
 #else
@@ -10,6 +10,8 @@ std::shared_ptr<DataPicture> DataPicture::create(OutputPicture *out, const Resol
 	case RGB24: r = safe_cast<DataPicture>(out->getBuffer<PictureRGB24>(size)); break;
 	default: throw std::runtime_error("Unknown pixel format for DataPicture. Please contact your vendor");
 	}
+	if (!r)
+		return nullptr;
 	r->setResolution(res);
 	return r;
 }
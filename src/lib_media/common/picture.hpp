@@ -69,9 +69,13 @@ class DataPicture;
 typedef OutputDataDefault<DataPicture> OutputPicture;
 
 //TODO: we should probably separate planar vs non-planar data, avoid resize on the data, etc.
+/* each plane starts on an aligned address and its pitch is a multiple of the alignment: size() includes this padding */
 class DataPicture : public DataRaw {
 	public:
+		static const size_t PlaneAlignment = BUFFER_ALIGNMENT_DEFAULT;
+
 		DataPicture(size_t unused) : DataRaw(0) {}
+		/* nullptr when the output has no buffer for it (see MemoryBudgetDrop): the frame is dropped */
 		static std::shared_ptr<DataPicture> create(OutputPicture *out, const Resolution &res, const PixelFormat &format);
 
 		virtual bool isRecyclable() const override {
@@ -92,8 +96,7 @@ class DataPicture : public DataRaw {
 
 	protected:
 		DataPicture(const Resolution &res, const PixelFormat &format)
-			: DataRaw(PictureFormat::getSize(res, format)),
-			  m_format(res, format) {
+			: DataRaw(0), m_format(res, format) {
 		}
 
 		PictureFormat m_format;
@@ -122,14 +125,14 @@ class PictureYUV420P : public DataPicture {
 		}
 		void setResolution(const Resolution &res) override {
 			m_format.res = res;
-			resize(m_format.getSize());
-			auto const numPixels = res.width * res.height;
+			m_pitch[0] = alignUp(res.width, PlaneAlignment);
+			m_pitch[1] = alignUp(res.width / 2, PlaneAlignment);
+			m_pitch[2] = alignUp(res.width / 2, PlaneAlignment);
+			auto const lumaSize = m_pitch[0] * res.height, chromaSize = m_pitch[1] * (res.height / 2);
+			resize(lumaSize + 2 * chromaSize);
 			m_planes[0] = data();
-			m_planes[1] = data() + numPixels;
-			m_planes[2] = data() + numPixels + numPixels / 4;
-			m_pitch[0] = res.width;
-			m_pitch[1] = res.width / 2;
-			m_pitch[2] = res.width / 2;
+			m_planes[1] = data() + lumaSize;
+			m_planes[2] = data() + lumaSize + chromaSize;
 		}
 
 	private:
@@ -156,11 +159,11 @@ class PictureYUYV422 : public DataPicture {
 			return data();
 		}
 		size_t getPitch(size_t planeIdx) const override {
-			return m_format.res.width * 2;
+			return alignUp(m_format.res.width * 2, PlaneAlignment);
 		}
 		void setResolution(const Resolution &res) override {
 			m_format.res = res;
-			resize(m_format.getSize());
+			resize(getPitch(0) * res.height);
 		}
 };
 
@@ -183,11 +186,11 @@ class PictureRGB24 : public DataPicture {
 			return data();
 		}
 		size_t getPitch(size_t planeIdx) const override {
-			return m_format.res.width * 3;
+			return alignUp(m_format.res.width * 3, PlaneAlignment);
 		}
 		void setResolution(const Resolution &res) override {
 			m_format.res = res;
-			resize(m_format.getSize());
+			resize(getPitch(0) * res.height);
 		}
 };
 
@@ -66,7 +66,9 @@ void JPEGTurboDecode::process(Data data_) {
 		return;
 	}
 	auto out = DataPicture::create(output, Resolution(w, h), RGB24);
-	if (tjDecompress2(jtHandle->get(), (unsigned char*)jpegBuf, (unsigned long)data->size(), out->data(), w, 0/*pitch*/, h, pixelFmt, TJFLAG_FASTDCT) < 0) {
+	if (!out)
+		return;
+	if (tjDecompress2(jtHandle->get(), (unsigned char*)jpegBuf, (unsigned long)data->size(), out->data(), w, (int)out->getPitch(0), h, pixelFmt, TJFLAG_FASTDCT) < 0) {
 		log(Warning, "error encountered while decompressing frame.");
 		return;
 	}
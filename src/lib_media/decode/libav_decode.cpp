@@ -67,6 +67,8 @@ bool LibavDecode::processAudio(const DataAVPacket *data) {
 	}
 	if (gotFrame) {
 		auto out = audioOutput->getBuffer(0);
+		if (!out)
+			return true; //dropped: the decoder state is kept
 		PcmFormat pcmFormat;
 		libavFrame2pcmConvert(avFrame->get(), &pcmFormat);
 		out->setFormat(pcmFormat);
@@ -74,6 +76,7 @@ bool LibavDecode::processAudio(const DataAVPacket *data) {
 			out->setPlane(i, avFrame->get()->data[i], avFrame->get()->nb_samples * pcmFormat.getBytesPerSample());
 		}
 		out->setTime(data->getTime());
+		out->setIngestTime(data->getIngestTime());
 		audioOutput->emit(out);
 		return true;
 	}
@@ -114,8 +117,11 @@ bool LibavDecode::processVideo(const DataAVPacket *data) {
 	}
 	if (gotPicture) {
 		auto pic = DataPicture::create(videoOutput, Resolution(avFrame->get()->width, avFrame->get()->height), libavPixFmt2PixelFormat((AVPixelFormat)avFrame->get()->format));
+		if (!pic)
+			return true; //dropped: the decoder state is kept
 		copyToPicture(avFrame->get(), pic.get());
 		pic->setTime(data->getTime());
+		pic->setIngestTime(data->getIngestTime());
 		videoOutput->emit(pic);
 		return true;
 	}
@@ -124,7 +130,7 @@ bool LibavDecode::processVideo(const DataAVPacket *data) {
 }
 
 void LibavDecode::process(Data data) {
-	auto decoderData = safe_cast<const DataAVPacket>(data);
+	auto decoderData = input_cast<DataAVPacket>(data);
 	switch (codecCtx->codec_type) {
 	case AVMEDIA_TYPE_VIDEO:
 		processVideo(decoderData.get());
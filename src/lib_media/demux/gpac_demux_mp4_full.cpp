@@ -110,8 +110,10 @@ bool GPACDemuxMP4Full::processSample() {
 					reader->sampleIndex++;
 
 					auto out = output->getBuffer(ISOSample->dataLength);
-					memcpy(out->data(), ISOSample->data, ISOSample->dataLength);
-					output->emit(out);
+					if (out) { //nullptr: the sample is dropped
+						memcpy(out->data(), ISOSample->data, ISOSample->dataLength);
+						output->emit(out);
+					}
 				}
 
 				/* once we have read all the samples, we can release some data and force a reparse of the input buffer */
@@ -53,8 +53,10 @@ void GPACDemuxMP4Simple::process(Data /*data*/) {
 			reader->sampleIndex++;
 
 			auto out = output->getBuffer(ISOSample->dataLength);
-			memcpy(out->data(), ISOSample->data, ISOSample->dataLength);
-			output->emit(out);
+			if (out) { //nullptr: the sample is dropped
+				memcpy(out->data(), ISOSample->data, ISOSample->dataLength);
+				output->emit(out);
+			}
 		} catch (gpacpp::Error const& err) {
 			if (err.error_ == GF_ISOM_INCOMPLETE_FILE) {
 				u64 missingBytes = reader->movie->getMissingBytes(reader->trackNumber);
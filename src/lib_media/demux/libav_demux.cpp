@@ -126,6 +126,9 @@ void LibavDemux::process(Data data) {
 			break;
 
 		auto out = outputs[0]->getBuffer(0);
+		auto const dropped = !out;
+		if (dropped)
+			out = std::make_shared<DataAVPacket>(); //read and discarded: the demuxer moves on
 		AVPacket *pkt = out->getPacket();
 		int status = av_read_frame(m_formatCtx, pkt);
 		if (status < 0) {
@@ -137,8 +140,10 @@ void LibavDemux::process(Data data) {
 		}
 
 		setTime(out);
+		out->setIngestTime(getWallClockInUs());
 
-		outputs[pkt->stream_index]->emit(out);
+		if (!dropped)
+			outputs[pkt->stream_index]->emit(out);
 	}
 
 	log(Info, "Exit from an external event.");
@@ -40,10 +40,12 @@ void JPEGTurboEncode::process(Data data_) {
 	auto const w = data->getFormat().res.width, h = data->getFormat().res.height;
 	auto const dataSize = tjBufSize(w, h, TJSAMP_420);
 	auto out = output->getBuffer(dataSize);
+	if (!out)
+		return;
 	unsigned char *buf = (unsigned char*)out->data();
 	auto jpegBuf = data->data();
 	unsigned long jpegSize;
-	if (tjCompress2(jtHandle->get(), (unsigned char*)jpegBuf, w, 0/*pitch*/, h, TJPF_RGB, &buf, &jpegSize, TJSAMP_420, JPEGQuality, TJFLAG_FASTDCT) < 0) {
+	if (tjCompress2(jtHandle->get(), (unsigned char*)jpegBuf, w, (int)data->getPitch(0), h, TJPF_RGB, &buf, &jpegSize, TJSAMP_420, JPEGQuality, TJFLAG_FASTDCT) < 0) {
 		log(Warning, "error encountered while compressing.");
 		return;
 	}
@@ -186,6 +186,10 @@ LibavEncode::~LibavEncode() {
 
 bool LibavEncode::processAudio(const DataPcm *data) {
 	auto out = output->getBuffer(0);
+	if (!out)
+		return false; //dropped: the frame is not encoded
+	if (data)
+		times.push({data->getTime(), data->getIngestTime()});
 	AVPacket *pkt = out->getPacket();
 	AVFrame *f = nullptr;
 	if (data) {
@@ -201,15 +205,16 @@ bool LibavEncode::processAudio(const DataPcm *data) {
 	}
 	if (gotPkt) {
 		pkt->pts = pkt->dts = frameNum * pkt->duration;
-		uint64_t time;
-		if (times.tryPop(time)) {
-			out->setTime(time);
+		Times t;
+		if (times.tryPop(t)) {
+			out->setTime(t.time);
+			out->setIngestTime(t.ingestTime);
 		} else {
 			log(Warning, "error encountered: more output packets than input. Discard", frameNum);
 			return false;
 		}
 		assert(pkt->size);
-		if (out) output->emit(out);
+		output->emit(out);
 		return true;
 	}
 
@@ -218,6 +223,10 @@ bool LibavEncode::processAudio(const DataPcm *data) {
 
 bool LibavEncode::processVideo(const DataPicture *pic) {
 	auto out = output->getBuffer(0);
+	if (!out)
+		return false; //dropped: the frame is not encoded
+	if (pic)
+		times.push({pic->getTime(), pic->getIngestTime()});
 	AVPacket *pkt = out->getPacket();
 
 	std::shared_ptr<ffpp::Frame> f;
@@ -246,7 +255,9 @@ bool LibavEncode::processVideo(const DataPicture *pic) {
 				assert(codecCtx->time_base.num >= 0);
 				pkt->duration = (int)timescaleToClock((uint64_t)codecCtx->time_base.num, codecCtx->time_base.den);
 			}
-			out->setTime(times.pop());
+			auto const t = times.pop();
+			out->setTime(t.time);
+			out->setIngestTime(t.ingestTime);
 			output->emit(out);
 			return true;
 		}
@@ -256,15 +267,14 @@ bool LibavEncode::processVideo(const DataPicture *pic) {
 }
 
 void LibavEncode::process(Data data) {
-	times.push(data->getTime());
 	switch (codecCtx->codec_type) {
 	case AVMEDIA_TYPE_VIDEO: {
-		const auto encoderData = safe_cast<const DataPicture>(data);
+		const auto encoderData = input_cast<DataPicture>(data);
 		processVideo(encoderData.get());
 		break;
 	}
 	case AVMEDIA_TYPE_AUDIO: {
-		const auto pcmData = safe_cast<const DataPcm>(data);
+		const auto pcmData = input_cast<DataPcm>(data);
 		if (pcmData->getFormat() != *pcmFormat)
 			throw error("Incompatible audio data");
 		processAudio(pcmData.get());
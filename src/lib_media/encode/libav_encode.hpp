@@ -46,7 +46,10 @@ class LibavEncode : public ModuleS {
 		AVCodecContext *codecCtx;
 		std::unique_ptr<PcmFormat> pcmFormat;
 		std::unique_ptr<ffpp::Frame> const avFrame;
-		Signals::Queue<uint64_t> times;
+		struct Times {
+			uint64_t time, ingestTime;
+		};
+		Signals::Queue<Times> times; //input times, in encoding order
 		int frameNum;
 		OutputDataDefault<DataAVPacket>* output;
 };
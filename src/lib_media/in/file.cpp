@@ -12,7 +12,7 @@ File::File(std::string const& fn) {
 		throw error(format("Can't open file for reading: %s", fn));
 
 	fseek(file, 0, SEEK_END);
-	auto size = ftell(file);
+	size = ftell(file);
 	fseek(file, 0, SEEK_SET);
 	if (size > IOSIZE)
 		log(Info, "File %s size is %s, will be sent by %s bytes chunks. Check the downstream modules are able to agregate data frames.", fn, size, IOSIZE);
@@ -30,6 +30,12 @@ void File::process(Data data) {
 			break;
 
 		auto out = output->getBuffer(IOSIZE);
+		if (!out) {
+			//dropped: the chunk is skipped
+			if (fseek(file, IOSIZE, SEEK_CUR) || ftell(file) >= size)
+				break;
+			continue;
+		}
 		size_t read = fread(out->data(), 1, IOSIZE, file);
 		if (read < IOSIZE) {
 			if (read == 0) {
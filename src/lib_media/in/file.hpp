@@ -14,6 +14,7 @@ class File : public ModuleS {
 
 	private:
 		FILE *file;
+		long size;
 		OutputDefault* output;
 };
 
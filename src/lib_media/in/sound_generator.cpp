@@ -26,10 +26,15 @@ void SoundGenerator::process(Data /*data*/) {
 	auto const bufferSize = bytesPerSample * sampleDurationInMs * pcmFormat.sampleRate / 1000;
 
 	auto out = output->getBuffer(0);
+	if (!out) {
+		m_numSamples += bufferSize / bytesPerSample; //dropped
+		return;
+	}
 	out->setFormat(pcmFormat);
 	for (uint8_t i = 0; i < pcmFormat.numPlanes; ++i)
 		out->setPlane(i, nullptr, bufferSize / pcmFormat.numPlanes);
 	out->setTime(timescaleToClock(m_numSamples, pcmFormat.sampleRate));
+	out->setIngestTime(getWallClockInUs());
 
 	// generate sound
 	auto const p = out->data();
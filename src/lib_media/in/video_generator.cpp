@@ -15,17 +15,22 @@ VideoGenerator::VideoGenerator() {
 void VideoGenerator::process(Data /*data*/) {
 	auto const dim = VIDEO_RESOLUTION;
 	auto pic = DataPicture::create(output, dim, YUV420P);
+	if (!pic) {
+		++m_numFrames; //dropped
+		return;
+	}
 
 	// generate video
 	auto const p = pic->data();
 	auto const FLASH_PERIOD = FRAMERATE;
 	auto const flash = (m_numFrames % FLASH_PERIOD) == 0;
 	auto const val = flash ? 0xCC : 0x80;
-	memset(p, val, pic->getSize());
+	memset(p, val, (size_t)pic->size());
 
 	auto const framePeriodIn180k = IClock::Rate / FRAMERATE;
 	assert(IClock::Rate % FRAMERATE == 0);
 	pic->setTime(m_numFrames * framePeriodIn180k);
+	pic->setIngestTime(getWallClockInUs());
 
 	if (m_numFrames % 25 < 2)
 		output->emit(pic);
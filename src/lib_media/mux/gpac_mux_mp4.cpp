@@ -652,6 +652,8 @@ void GPACMuxMP4::sendOutput() {
 	if (e) throw error(format("Could not compute codec name (RFC 6381)"));
 
 	auto out = output->getBuffer(0);
+	if (!out)
+		return; //the segment is written, only its notification is dropped
 	auto metadata = std::make_shared<MetadataFile>(m_chunkName, streamType, mimeType, gf_strdup(codecName), m_curFragDur, m_lastChunkSize, m_chunkStartsWithRAP);
 	out->setMetadata(metadata);
 	auto const mediaTimescale = gf_isom_get_media_timescale(m_iso, gf_isom_get_track_by_id(m_iso, m_trackId));
@@ -661,6 +663,8 @@ void GPACMuxMP4::sendOutput() {
 	default: throw error(format("Segment contains neither audio nor video"));
 	}
 	out->setTime(m_DTS, mediaTimescale);
+	out->setIngestTime(m_chunkIngestTime);
+	m_chunkIngestTime = 0;
 	output->emit(out);
 }
 
@@ -781,6 +785,8 @@ void GPACMuxMP4::process() {
 		dataDurationInTs = TIMESCALE_MUL;
 	}
 	addSample(sample, dataDurationInTs);
+	if (!m_chunkIngestTime) //after addSample(): the sample may have started a new chunk
+		m_chunkIngestTime = data->getIngestTime();
 }
 
 }
@@ -42,6 +42,7 @@ class GPACMuxMP4 : public ModuleDynI {
 		uint64_t m_chunkDuration;
 		uint64_t m_chunkNum = 0, m_lastChunkSize = 0;
 		bool m_chunkStartsWithRAP = true;
+		uint64_t m_chunkIngestTime = 0; //of the first sample of the chunk
 		std::string m_chunkName;
 
 		OutputDataDefault<DataAVPacket>* output;
@@ -1,9 +1,33 @@
 #include "lib_utils/tools.hpp"
 #include "file.hpp"
+#include "../common/picture.hpp"
 
 namespace Modules {
 namespace Out {
 
+namespace {
+/* the planes are written without their padding: the dump is a packed raw frame of getSize() bytes */
+void writePicture(FILE *file, const DataPicture *pic) {
+	auto const &format = pic->getFormat();
+	auto const bytesPerPixel = format.format == YUYV422 ? 2 : format.format == RGB24 ? 3 : 1;
+	for (size_t plane = 0; plane < pic->getNumPlanes(); ++plane) {
+		auto const subsampling = plane == 0 ? 1 : 2;
+		auto const width = format.res.width * bytesPerPixel / subsampling;
+		auto const height = format.res.height / subsampling;
+		auto const pitch = pic->getPitch(plane);
+		auto src = pic->getPlane(plane);
+		if (pitch == width) {
+			fwrite(src, 1, width * height, file);
+			continue;
+		}
+		for (unsigned y = 0; y < height; ++y) {
+			fwrite(src, 1, width, file);
+			src += pitch;
+		}
+	}
+}
+}
+
 File::File(std::string const& path) {
 	file = fopen(path.c_str(), "wb");
 	if (!file)
@@ -17,6 +41,10 @@ File::~File() {
 }
 
 void File::process(Data data_) {
+	if (auto pic = std::dynamic_pointer_cast<const DataPicture>(data_)) {
+		writePicture(file, pic.get());
+		return;
+	}
 	auto data = safe_cast<const DataBase>(data_);
 	fwrite(data->data(), 1, (size_t)data->size(), file);
 }
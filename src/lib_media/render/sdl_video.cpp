@@ -82,7 +82,7 @@ bool SDLVideo::processOneFrame(Data data) {
 		}
 	}
 
-	auto pic = safe_cast<const DataPicture>(data);
+	auto pic = input_cast<DataPicture>(data);
 	if (pic->getFormat() != pictureFormat) {
 		pictureFormat = pic->getFormat();
 		createTexture();
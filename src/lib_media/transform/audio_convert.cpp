@@ -58,7 +58,7 @@ void AudioConvert::flush() {
 void AudioConvert::process(Data data) {
 	uint64_t srcNumSamples, dstNumSamples;
 	uint8_t * const * pSrc;
-	auto audioData = safe_cast<const DataPcm>(data);
+	auto audioData = input_cast<DataPcm>(data);
 	if (audioData) {
 		if (audioData->getFormat() != srcPcmFormat) {
 			if (autoConfigure) {
@@ -73,6 +73,7 @@ void AudioConvert::process(Data data) {
 		srcNumSamples = audioData->size() / audioData->getFormat().getBytesPerSample();
 		dstNumSamples = divUp(srcNumSamples * dstPcmFormat.sampleRate, (uint64_t)srcPcmFormat.sampleRate); //FIXME: this number depends on the next module (encoder) spec
 		pSrc = audioData->getPlanes();
+		lastIngestTime = data->getIngestTime();
 	} else {
 		dstNumSamples = m_Swr->getDelay(dstPcmFormat.sampleRate);
 		if (dstNumSamples == 0)
@@ -83,6 +84,8 @@ void AudioConvert::process(Data data) {
 
 	auto const dstBufferSize = dstNumSamples * dstPcmFormat.getBytesPerSample();
 	auto out = output->getBuffer(0);
+	if (!out)
+		return;
 	out->setFormat(dstPcmFormat);
 	for (uint8_t i=0; i < dstPcmFormat.numPlanes; ++i)
 		out->setPlane(i, nullptr, dstBufferSize / dstPcmFormat.numPlanes);
@@ -97,6 +100,7 @@ void AudioConvert::process(Data data) {
 	accumulatedTimeInDstSR += outNumSamples;
 	auto const accumulatedTimeIn180k = timescaleToClock(accumulatedTimeInDstSR, dstPcmFormat.sampleRate);
 	out->setTime(accumulatedTimeIn180k);
+	out->setIngestTime(lastIngestTime); //the resampler delay is flushed with the latest input
 
 	output->emit(out);
 }
@@ -26,6 +26,7 @@ class AudioConvert : public ModuleS {
 		PcmFormat srcPcmFormat, dstPcmFormat;
 		std::unique_ptr<ffpp::SwResampler> m_Swr;
 		uint64_t accumulatedTimeInDstSR;
+		uint64_t lastIngestTime = 0;
 		OutputPcm* output;
 		bool autoConfigure;
 };
@@ -36,7 +36,7 @@ VideoConvert::~VideoConvert() {
 }
 
 void VideoConvert::process(Data data) {
-	auto videoData = safe_cast<const DataPicture>(data);
+	auto videoData = input_cast<DataPicture>(data);
 	if (videoData->getFormat() != srcFormat) {
 		if (m_SwContext)
 			log(Info, "Incompatible input video data. Reconfiguring.");
@@ -58,6 +58,8 @@ void VideoConvert::process(Data data) {
 	case YUYV422:
 	case RGB24: {
 		auto pic = DataPicture::create(output, dstFormat.res, dstFormat.format);
+		if (!pic)
+			return;
 		for (size_t i=0; i<pic->getNumPlanes(); ++i) {
 			pDst[i] = pic->getPlane(i);
 			dstStride[i] = (int)pic->getPitch(i);
@@ -72,6 +74,7 @@ void VideoConvert::process(Data data) {
 	sws_scale(m_SwContext, srcSlice, srcStride, 0, srcFormat.res.height, pDst, dstStride);
 
 	out->setTime(data->getTime());
+	out->setIngestTime(data->getIngestTime());
 	output->emit(out);
 }
 
@@ -1,90 +1,522 @@
 #pragma once
 
 #include "data.hpp"
-#include "lib_signals/utils/queue.hpp"
+#include "huge_page_arena.hpp"
+#include "memory_budget.hpp"
+#include "lib_signals/utils/queue_lock_free.hpp"
 #include <algorithm>
-#include <list>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 namespace Modules {
 
 static const size_t ALLOC_NUM_BLOCKS_DEFAULT = 10;
 static const size_t ALLOC_NUM_BLOCKS_LOW_LATENCY = 2;
 
+/* what a getBuffer() with a timeout does when no block was recycled in time */
+enum AllocatorFallback {
+	AllocatorReturnNull, //the caller decides (e.g. drops the frame)
+	AllocatorUseHeap,    //allocates an extra block outside of the pool: it is deleted when released
+};
+
+struct AllocatorStats {
+	size_t numBlocks;          //per size class
+	size_t numBlocksInFlight;  //pooled blocks currently held outside of the allocator
+	size_t highWaterMark;      //maximum of numBlocksInFlight
+	uint64_t numBytes;         //held by the pooled blocks, free or in flight
+	uint64_t numResizes;       //blocks grown to satisfy a getBuffer() size
+	uint64_t numHeapFallbacks; //blocks allocated outside of the pool after a timeout or a memory budget spill
+	uint64_t blockedTimeInUs;  //cumulative time spent by getBuffer() callers waiting for a free block
+};
+
+/* unique across the process lifetime (contrary to addresses): keys the per-thread caches */
+inline uint64_t getNextAllocatorId() {
+	static std::atomic<uint64_t> id(0);
+	return ++id;
+}
+
+/**
+ * Pool of recyclable blocks.
+ * Blocks are sorted in size classes, so that small packets are not recycled into large pictures. numBlocks limits
+ * the blocks of all the classes: once reached, an idle block of another class is deleted to make room.
+ * Each class keeps its free blocks in a lock-free list. On top of it, each allocating thread caches a few free
+ * blocks per class (its magazine): allocating and recycling on the same thread doesn't touch the shared list.
+ * Blocks recycled by other threads go to the shared list. A thread waiting for a block also takes them from the
+ * other threads' magazines. Small pools (numBlocks <= MagazineSize) have no magazines: one would hold them all.
+ * Blocks are created only when no idle one is available: the pool grows up to the observed depth. Their bytes
+ * are accounted in the process-wide MemoryBudget, which trims the idle blocks under memory pressure.
+ */
 template<typename DataType>
-class PacketAllocator {
+class PacketAllocator : public IMemoryBudgetClient {
 	public:
 		typedef DataType MyType;
-		PacketAllocator(size_t numBlocks) {
+
+		static const size_t NumSizeClasses = 8;
+		static const size_t MinClassSize = 256; //class i holds requests up to MinClassSize*4^i bytes, the last class is unbounded
+		static const size_t MagazineSize = 4;
+
+		/* the free lists are recycled from any thread: use QueueLocked or QueueLockFreeMPMC */
+		PacketAllocator(size_t numBlocks, Signals::QueueType freeListType = Signals::QueueLockFreeMPMC)
+			: id(getNextAllocatorId()), numBlocks(numBlocks), magazineCapacity(numBlocks > MagazineSize ? MagazineSize : 0), numCreated(0), budget(MemoryBudget::global()), numWaiters(0), exiting(false),
+			  numBlocksInFlight(0), highWaterMark(0), numBytes(0), numResizes(0), numHeapFallbacks(0), blockedTimeInUs(0) {
 			if (numBlocks == 0)
 				throw std::runtime_error("Cannot create an allocator with 0 block.");
-			for(size_t i=0; i < numBlocks; ++i) {
-				freeBlocks.push(Block());
+			if (freeListType == Signals::QueueLockFreeSPSC)
+				throw std::runtime_error("Allocator free list cannot be single producer.");
+			for (auto &freeList : freeBlocks) {
+				freeList.reset(Signals::createQueue<DataType*>(freeListType, numBlocks));
 			}
+			budget.registerClient(this);
 		}
 
 		~PacketAllocator() {
-			Block block;
-			while(freeBlocks.tryPop(block))
-				delete block.data;
+			budget.unregisterClient(this);
+			trim();
 		}
 
-		struct Deleter {
-			Deleter(PacketAllocator<DataType> *allocator) : allocator(allocator) {}
-			void operator()(DataType *p) const {
-				allocator->recycle(p);
-			}
-			PacketAllocator<DataType> * const allocator;
-		};
-
+		/**
+		 * Blocks until a block of the right size class is available, or returns nullptr after unblock().
+		 * Also returns nullptr when the memory budget is exhausted with the MemoryBudgetDrop policy.
+		 */
 		template<typename T>
 		std::shared_ptr<T> getBuffer(size_t size) {
-			auto block = freeBlocks.pop();
-			switch(block.event) {
-			case OneBufferIsFree: {
-				if (!block.data) {
-					delete block.data;
-					block.data = new T(size);
-				} else {
-					auto data = safe_cast<T>(block.data);
-					if (data->size() < size)
-						data->resize(size);
-				}
+			return acquire<T>(size, nullptr, AllocatorReturnNull);
+		}
+
+		/* waits at most timeout (0 doesn't block), then applies the fallback */
+		template<typename T>
+		std::shared_ptr<T> getBuffer(size_t size, std::chrono::microseconds timeout, AllocatorFallback fallback) {
+			auto const deadline = std::chrono::steady_clock::now() + timeout;
+			return acquire<T>(size, &deadline, fallback);
+		}
+
+		/* buffers of the blocks created from now on are allocated from the arena: call before the first getBuffer() */
+		void setBufferArena(std::shared_ptr<IBufferArena> bufferArena) {
+			arena = std::move(bufferArena);
+		}
 
-				return std::shared_ptr<T>(safe_cast<T>(block.data), Deleter(this));
+		/* wakes up the waiting getBuffer() calls: they return nullptr */
+		void unblock() {
+			exiting = true;
+			{
+				std::lock_guard<std::mutex> lock(waitMutex);
+				blockFreed.notify_all();
 			}
-			case Exit:
-				return nullptr;
+			budget.wakeUp();
+		}
+
+		/* deletes the idle blocks, and trims the arena. Returns the number of bytes released. */
+		uint64_t trim() override {
+			uint64_t bytes = 0;
+			DataType *block;
+			for (size_t sizeClass = 0; sizeClass < NumSizeClasses; ++sizeClass) {
+				while (freeBlocks[sizeClass]->tryPop(block) || stealFromThreads(sizeClass, block))
+					bytes += destroyBlock(block);
 			}
-			return nullptr;
+			if (arena)
+				arena->trim();
+			return bytes;
 		}
 
-		void unblock() {
-			freeBlocks.push(Block(Exit));
+		AllocatorStats getStats() const {
+			AllocatorStats stats;
+			stats.numBlocks = numBlocks;
+			stats.numBlocksInFlight = numBlocksInFlight;
+			stats.highWaterMark = highWaterMark;
+			stats.numBytes = (uint64_t)std::max<int64_t>(numBytes, 0);
+			stats.numResizes = numResizes;
+			stats.numHeapFallbacks = numHeapFallbacks;
+			stats.blockedTimeInUs = blockedTimeInUs;
+			return stats;
+		}
+
+		static size_t getSizeClass(size_t size) {
+			size_t sizeClass = 0, classSize = MinClassSize;
+			while (size > classSize && sizeClass + 1 < NumSizeClasses) {
+				classSize *= 4;
+				sizeClass++;
+			}
+			return sizeClass;
 		}
 
 	private:
 		PacketAllocator& operator= (const PacketAllocator&) = delete;
-		void recycle(DataType *p) {
-			if (!p->isRecyclable()) {
-				delete p;
-				p = nullptr;
+
+		/* the owner thread puts and takes, any thread can steal. A nullptr slot is empty. */
+		struct Magazine {
+			Magazine() {
+				for (auto &block : blocks)
+					block = nullptr;
 			}
-			freeBlocks.push(Block(OneBufferIsFree, p));
+			bool put(DataType *block, size_t capacity) {
+				for (size_t i = 0; i < capacity; ++i) {
+					if (!blocks[i].load(std::memory_order_relaxed)) {
+						blocks[i].store(block); //only the owner fills slots: no race
+						return true;
+					}
+				}
+				return false;
+			}
+			bool steal(DataType *&block) {
+				for (auto &slot : blocks) {
+					if (slot.load(std::memory_order_relaxed) && (block = slot.exchange(nullptr)))
+						return true;
+				}
+				return false;
+			}
+			std::atomic<DataType*> blocks[MagazineSize];
+		};
+		struct ThreadMagazines {
+			Magazine classes[NumSizeClasses];
+		};
+
+		struct ThreadCacheEntry {
+			ThreadMagazines *magazines;
+			std::weak_ptr<ThreadMagazines> owner; //expires with the allocator
+		};
+		struct ThreadCache {
+			//one-entry cache in front of the map: a thread usually allocates from the same output
+			uint64_t lastId = 0;
+			ThreadMagazines *last = nullptr;
+			std::unordered_map<uint64_t, ThreadCacheEntry> magazines;
+
+			/* removes the entries of the destroyed allocators: called before adding one, so the map doesn't grow with them */
+			void prune() {
+				for (auto entry = magazines.begin(); entry != magazines.end();) {
+					if (entry->second.owner.expired())
+						entry = magazines.erase(entry);
+					else
+						++entry;
+				}
+			}
+		};
+		static ThreadCache& getThreadCache() {
+			static thread_local ThreadCache cache;
+			return cache;
+		}
+
+		/* the magazines are created by the first allocation of the thread */
+		ThreadMagazines& getThreadMagazines() {
+			auto &cache = getThreadCache();
+			if (cache.lastId != id) {
+				auto entry = cache.magazines.find(id);
+				if (entry == cache.magazines.end()) {
+					cache.prune();
+					auto const magazines = std::make_shared<ThreadMagazines>();
+					{
+						std::lock_guard<std::mutex> lock(magazinesMutex);
+						threadMagazines.push_back(magazines);
+					}
+					entry = cache.magazines.insert(std::make_pair(id, ThreadCacheEntry { magazines.get(), magazines })).first;
+				}
+				cache.lastId = id;
+				cache.last = entry->second.magazines;
+			}
+			return *cache.last;
+		}
+
+		/* nullptr when the thread never allocated from this allocator */
+		ThreadMagazines* findThreadMagazines() {
+			auto &cache = getThreadCache();
+			if (cache.lastId == id)
+				return cache.last;
+			auto const entry = cache.magazines.find(id);
+			return entry != cache.magazines.end() ? entry->second.magazines : nullptr;
 		}
 
-		enum Event {
-			OneBufferIsFree,
-			Exit,
+		/* a nullptr block means that a new block can be created: idle blocks are preferred */
+		bool tryAcquire(size_t sizeClass, DataType *&block) {
+			return (magazineCapacity && getThreadMagazines().classes[sizeClass].steal(block)) || tryAcquireAny(sizeClass, block);
+		}
+
+		bool tryAcquireAny(size_t sizeClass, DataType *&block) {
+			return freeBlocks[sizeClass]->tryPop(block) || stealFromThreads(sizeClass, block) || tryCreate(block) || tryReclaim(sizeClass, block);
+		}
+
+		bool tryCreate(DataType *&block) {
+			auto created = numCreated.load();
+			do {
+				if (created >= numBlocks)
+					return false;
+			} while (!numCreated.compare_exchange_weak(created, created + 1));
+			block = nullptr;
+			return true;
+		}
+
+		/* all the blocks exist: deletes an idle block of another class to create one in this class */
+		bool tryReclaim(size_t sizeClass, DataType *&block) {
+			for (size_t otherClass = 0; otherClass < NumSizeClasses; ++otherClass) {
+				DataType *idle;
+				if (otherClass != sizeClass && (freeBlocks[otherClass]->tryPop(idle) || stealFromThreads(otherClass, idle))) {
+					destroyBlock(idle);
+					return tryCreate(block);
+				}
+			}
+			return false;
+		}
+
+		bool stealFromThreads(size_t sizeClass, DataType *&block) {
+			if (!magazineCapacity)
+				return false;
+			std::lock_guard<std::mutex> lock(magazinesMutex);
+			for (auto &magazines : threadMagazines) {
+				if (magazines->classes[sizeClass].steal(block))
+					return true;
+			}
+			return false;
+		}
+
+		/* no deadline means forever. Returns false on timeout or after unblock(). */
+		bool waitForBlock(size_t sizeClass, const std::chrono::steady_clock::time_point *deadline, DataType *&block) {
+			auto const waitStart = std::chrono::steady_clock::now();
+			auto const acquired = spinForBlock(sizeClass, deadline, block) || parkForBlock(sizeClass, deadline, block);
+			blockedTimeInUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - waitStart).count();
+			return acquired;
+		}
+
+		//blocks are usually recycled shortly: yield a few times before parking
+		bool spinForBlock(size_t sizeClass, const std::chrono::steady_clock::time_point *deadline, DataType *&block) {
+			for (int i = 0; i < 64 && !exiting && (!deadline || std::chrono::steady_clock::now() < *deadline); ++i) {
+				std::this_thread::yield();
+				if (tryAcquireAny(sizeClass, block))
+					return true;
+			}
+			return false;
+		}
+
+		bool parkForBlock(size_t sizeClass, const std::chrono::steady_clock::time_point *deadline, DataType *&block) {
+			numWaiters++;
+			std::atomic_thread_fence(std::memory_order_seq_cst); //pairs with recycle(): either we see the block or it sees us
+			bool acquired = false;
+			{
+				std::unique_lock<std::mutex> lock(waitMutex);
+				for (;;) {
+					if (tryAcquireAny(sizeClass, block)) {
+						acquired = true;
+						break;
+					}
+					if (exiting)
+						break;
+					if (!deadline)
+						blockFreed.wait(lock);
+					else if (blockFreed.wait_until(lock, *deadline) == std::cv_status::timeout)
+						break;
+				}
+			}
+			numWaiters--;
+			return acquired;
+		}
+
+		/* the deleter does nothing: the block is recycled once its control block is released */
+		struct NoDelete {
+			void operator()(DataType*) const {}
 		};
-		struct Block {
-			Block(Event event = OneBufferIsFree, DataType *data = nullptr): event(event), data(data) {}
-			Event event;
-			DataType *data;
+
+		/**
+		 * Places the shared_ptr control block in the block itself (DataBase::controlBlock): handing out a block
+		 * doesn't allocate and the reference counts share the block cache lines. Deallocating the control block
+		 * means that no shared_ptr nor weak_ptr reference the block anymore: it is recycled.
+		 */
+		template<typename U>
+		struct ControlBlockAllocator {
+			typedef U value_type;
+			template<typename V> struct rebind {
+				typedef ControlBlockAllocator<V> other;
+			};
+
+			ControlBlockAllocator(PacketAllocator *allocator, DataType *block, size_t sizeClass, uint64_t size)
+				: allocator(allocator), block(block), sizeClass(sizeClass), size(size) {
+			}
+			template<typename V>
+			ControlBlockAllocator(const ControlBlockAllocator<V> &other)
+				: allocator(other.allocator), block(other.block), sizeClass(other.sizeClass), size(other.size) {
+			}
+
+			U* allocate(size_t n) {
+				static_assert(sizeof(U) <= sizeof(DataBase::ControlBlockStorage), "DataBase::ControlBlockStorage is too small for this shared_ptr implementation.");
+				static_assert(alignof(U) <= alignof(DataBase::ControlBlockStorage), "DataBase::ControlBlockStorage alignment is too small for this shared_ptr implementation.");
+				if (n != 1)
+					throw std::bad_alloc();
+				return reinterpret_cast<U*>(&block->controlBlock);
+			}
+			void deallocate(U*, size_t) {
+				allocator->recycle(block, sizeClass, size);
+			}
+
+			template<typename V>
+			bool operator==(const ControlBlockAllocator<V> &other) const {
+				return block == other.block;
+			}
+			template<typename V>
+			bool operator!=(const ControlBlockAllocator<V> &other) const {
+				return block != other.block;
+			}
+
+			PacketAllocator *allocator;
+			DataType *block;
+			size_t sizeClass;
+			uint64_t size; //accounted in numBytes
 		};
 
-		Signals::Queue<Block> freeBlocks;
+		template<typename T>
+		std::shared_ptr<T> acquire(size_t size, const std::chrono::steady_clock::time_point *deadline, AllocatorFallback fallback) {
+			DataType *block;
+			auto const sizeClass = getSizeClass(size);
+			if (!tryAcquire(sizeClass, block) && !waitForBlock(sizeClass, deadline, block)) {
+				if (fallback == AllocatorUseHeap && !exiting) {
+					numHeapFallbacks++;
+					return std::shared_ptr<T>(new T(size));
+				}
+				return nullptr;
+			}
+
+			auto const currentSize = block ? (size_t)block->size() : 0;
+			auto const reserved = size > currentSize ? size - currentSize : 0;
+			if (reserved) {
+				switch (budget.reserve(reserved, deadline, exiting)) {
+				case MemoryBudget::Granted:
+					break;
+				case MemoryBudget::Spill:
+					release(block, sizeClass);
+					numHeapFallbacks++;
+					return std::shared_ptr<T>(new T(size));
+				default:
+					release(block, sizeClass);
+					return nullptr;
+				}
+			}
+			return makeBuffer<T>(block, size, sizeClass, reserved);
+		}
+
+		/* reserved: the bytes already accounted in the budget for this request */
+		template<typename T>
+		std::shared_ptr<T> makeBuffer(DataType *block, size_t size, size_t sizeClass, size_t reserved) {
+			T *data;
+			int64_t grownBytes;
+			if (!block) {
+				data = createBlock<T>(size, std::is_base_of<DataRaw, T>());
+				grownBytes = data->size();
+				numBytes += grownBytes;
+			} else {
+				data = safe_cast<T>(block);
+				data->setTraceId(0);
+				data->setIngestTime(0);
+				grownBytes = 0;
+				if (data->size() < size) {
+					grownBytes = -(int64_t)data->size();
+					data->resize(size);
+					grownBytes += data->size();
+					numBytes += grownBytes;
+					numResizes++;
+				}
+			}
+			if (grownBytes != (int64_t)reserved)
+				budget.account(grownBytes - (int64_t)reserved);
+			auto const inFlight = ++numBlocksInFlight;
+			auto hwm = highWaterMark.load();
+			while (inFlight > hwm && !highWaterMark.compare_exchange_weak(hwm, inFlight)) {
+			}
+			return std::shared_ptr<T>(data, NoDelete(), ControlBlockAllocator<T>(this, data, sizeClass, data->size()));
+		}
+
+		template<typename T>
+		T* createBlock(size_t size, std::true_type /*isDataRaw*/) {
+			if (!arena)
+				return new T(size);
+			auto data = new T(0);
+			data->setBufferArena(arena);
+			if (size)
+				data->resize(size);
+			return data;
+		}
+		template<typename T>
+		T* createBlock(size_t size, std::false_type /*isDataRaw*/) {
+			return new T(size);
+		}
+
+		/* accountedSize: the block size in numBytes, which may have been resized since */
+		void recycle(DataType *p, size_t sizeClass, uint64_t accountedSize) {
+			numBlocksInFlight--;
+			if (p->size() != accountedSize) {
+				auto const resizedBytes = (int64_t)p->size() - (int64_t)accountedSize;
+				numBytes += resizedBytes;
+				budget.account(resizedBytes);
+			}
+			if (!p->isRecyclable() || budget.hasWaiters()) { //under memory pressure, give the memory back rather than pooling it
+				destroyBlock(p);
+				return;
+			}
+			//a thread that only consumes would keep its blocks away from the allocating thread
+			auto const magazines = magazineCapacity ? findThreadMagazines() : nullptr;
+			if (!magazines || !magazines->classes[sizeClass].put(p, magazineCapacity))
+				freeBlocks[sizeClass]->push(p); //never blocks: there are never more than numBlocks blocks
+			notifyWaiters();
+		}
+
+		/* gives back an acquired block (or creation right, when nullptr) that won't be used */
+		void release(DataType *block, size_t sizeClass) {
+			if (block)
+				freeBlocks[sizeClass]->push(block);
+			else
+				numCreated--;
+			notifyWaiters();
+		}
+
+		uint64_t destroyBlock(DataType *block) {
+			auto const size = block->size();
+			delete block;
+			numBytes -= size;
+			budget.account(-(int64_t)size);
+			numCreated--;
+			notifyWaiters();
+			return size;
+		}
+
+		void notifyWaiters() {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (numWaiters > 0) {
+				std::lock_guard<std::mutex> lock(waitMutex);
+				blockFreed.notify_all();
+			}
+		}
+
+		uint64_t const id;
+		size_t const numBlocks;
+		size_t const magazineCapacity;
+		std::unique_ptr<Signals::IQueue<DataType*>> freeBlocks[NumSizeClasses];
+		std::atomic<size_t> numCreated; //blocks alive in all the classes, free or in flight
+		std::shared_ptr<IBufferArena> arena;
+		MemoryBudget &budget;
+
+		std::mutex magazinesMutex;
+		std::vector<std::shared_ptr<ThreadMagazines>> threadMagazines; //protected by magazinesMutex
+
+		std::mutex waitMutex;
+		std::condition_variable blockFreed;
+		std::atomic<int> numWaiters;
+		std::atomic_bool exiting;
+
+		std::atomic<size_t> numBlocksInFlight, highWaterMark;
+		std::atomic<int64_t> numBytes;
+		std::atomic<uint64_t> numResizes, numHeapFallbacks, blockedTimeInUs;
+};
+
+/* allocator policy for large pictures: see HugePageArena */
+template<typename DataType>
+class HugePagePacketAllocator : public PacketAllocator<DataType> {
+	public:
+		HugePagePacketAllocator(size_t numBlocks, Signals::QueueType freeListType = Signals::QueueLockFreeMPMC)
+			: PacketAllocator<DataType>(numBlocks, freeListType) {
+			this->setBufferArena(std::make_shared<HugePageArena>());
+		}
 };
 
 }
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace Modules {
+
+static const size_t BUFFER_ALIGNMENT_DEFAULT = 64;
+
+/* alignment must be a power of 2 */
+inline size_t alignUp(size_t size, size_t alignment) {
+	return (size + alignment - 1) & ~(alignment - 1);
+}
+
+/* memory source for buffers. The default is the heap. */
+struct IBufferArena {
+	virtual ~IBufferArena() {}
+	virtual void* alloc(size_t size, size_t alignment) = 0;
+	virtual void free(void *p, size_t size) = 0;
+	/* gives the memory that is not in use back to the system */
+	virtual void trim() {}
+};
+
+/**
+ * Contiguous bytes starting on an aligned address. Contrary to std::vector<uint8_t>, growing doesn't
+ * value-initialize: new bytes are left uninitialized (existing ones are kept). The allocation is rounded
+ * up to the alignment so that SIMD code can process the last bytes with full-width loads and stores.
+ */
+class AlignedBuffer {
+	public:
+		explicit AlignedBuffer(size_t size = 0, size_t alignment = BUFFER_ALIGNMENT_DEFAULT)
+			: ptr(nullptr), bufferSize(0), bufferCapacity(0), bufferAlignment(alignment) {
+			resize(size);
+		}
+		/* copies are allocated on the heap: they may outlive the arena users */
+		AlignedBuffer(const AlignedBuffer &other)
+			: ptr(nullptr), bufferSize(0), bufferCapacity(0), bufferAlignment(other.bufferAlignment) {
+			resize(other.bufferSize);
+			if (bufferSize)
+				memcpy(ptr, other.ptr, bufferSize);
+		}
+		AlignedBuffer(AlignedBuffer &&other)
+			: ptr(other.ptr), bufferSize(other.bufferSize), bufferCapacity(other.bufferCapacity), bufferAlignment(other.bufferAlignment), arena(std::move(other.arena)) {
+			other.ptr = nullptr;
+			other.bufferSize = other.bufferCapacity = 0;
+		}
+		AlignedBuffer& operator= (AlignedBuffer other) {
+			std::swap(ptr, other.ptr);
+			std::swap(bufferSize, other.bufferSize);
+			std::swap(bufferCapacity, other.bufferCapacity);
+			std::swap(bufferAlignment, other.bufferAlignment);
+			std::swap(arena, other.arena);
+			return *this;
+		}
+		~AlignedBuffer() {
+			release(ptr, bufferCapacity);
+		}
+
+		/* the current allocation is moved to the arena. The arena is kept alive until the memory is released. */
+		void setArena(std::shared_ptr<IBufferArena> newArena) {
+			auto const size = bufferSize;
+			AlignedBuffer previous(std::move(*this));
+			arena = std::move(newArena);
+			bufferAlignment = previous.bufferAlignment;
+			resize(size);
+			if (size)
+				memcpy(ptr, previous.ptr, size);
+		}
+
+		uint8_t* data() {
+			return ptr;
+		}
+		const uint8_t* data() const {
+			return ptr;
+		}
+		size_t size() const {
+			return bufferSize;
+		}
+		size_t capacity() const {
+			return bufferCapacity;
+		}
+		size_t alignment() const {
+			return bufferAlignment;
+		}
+
+		/* shrinking keeps the allocation */
+		void resize(size_t size) {
+			if (size > bufferCapacity) {
+				auto const newCapacity = alignUp(size, bufferAlignment);
+				auto newPtr = (uint8_t*)(arena ? arena->alloc(newCapacity, bufferAlignment) : allocAligned(newCapacity, bufferAlignment));
+				if (bufferSize)
+					memcpy(newPtr, ptr, bufferSize);
+				release(ptr, bufferCapacity);
+				ptr = newPtr;
+				bufferCapacity = newCapacity;
+			}
+			bufferSize = size;
+		}
+
+	private:
+		static void* allocAligned(size_t size, size_t alignment) {
+			void *p = nullptr;
+#ifdef _WIN32
+			p = _aligned_malloc(size, alignment);
+#else
+			if (posix_memalign(&p, alignment, size))
+				p = nullptr;
+#endif
+			if (!p)
+				throw std::bad_alloc();
+			return p;
+		}
+		void release(void *p, size_t capacity) {
+			if (arena && p)
+				arena->free(p, capacity);
+			else
+				freeAligned(p);
+		}
+		static void freeAligned(void *p) {
+#ifdef _WIN32
+			_aligned_free(p);
+#else
+			free(p);
+#endif
+		}
+
+		uint8_t *ptr;
+		size_t bufferSize, bufferCapacity, bufferAlignment;
+		std::shared_ptr<IBufferArena> arena;
+};
+
+}
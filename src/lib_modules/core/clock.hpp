@@ -14,6 +14,9 @@ IClock* createSystemClock();
 
 extern IClock* const g_DefaultClock;
 
+/* wall-clock time (microseconds since the epoch): comparable across modules and threads */
+uint64_t getWallClockInUs();
+
 static uint64_t convertToTimescale(uint64_t time, uint64_t timescaleSrc, uint64_t timescaleDst) {
 	return divUp<uint64_t>(time * timescaleDst, timescaleSrc);
 }
@@ -1,14 +1,20 @@
 #pragma once
 
+#include "buffer.hpp"
 #include "clock.hpp"
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
 namespace Modules {
 
 struct IMetadata;
+template<typename> class PacketAllocator;
 
 //A generic timed data container.
 class DataBase {
@@ -24,6 +30,10 @@ class DataBase {
 		std::shared_ptr<const IMetadata> getMetadata() const {
 			return m_metadata;
 		}
+		/* doesn't touch the reference count */
+		const IMetadata* getMetadataPtr() const {
+			return m_metadata.get();
+		}
 		void setMetadata(std::shared_ptr<const IMetadata> metadata) {
 			m_metadata = metadata;
 		}
@@ -38,19 +48,94 @@ class DataBase {
 			return m_TimeIn180k;
 		}
 
+		/* 0 when not traced: see Tracing */
+		uint64_t getTraceId() const {
+			return m_traceId.load(std::memory_order_relaxed);
+		}
+		void setTraceId(uint64_t traceId) {
+			m_traceId.store(traceId, std::memory_order_relaxed);
+		}
+		/* tags shared data (e.g. forwarded by a passthrough module): the first tag wins. Returns the trace id. */
+		uint64_t initTraceId(uint64_t traceId) const {
+			uint64_t current = 0;
+			return m_traceId.compare_exchange_strong(current, traceId, std::memory_order_relaxed) ? traceId : current;
+		}
+
+		/* wall-clock time when the source ingested the media (see getWallClockInUs()), 0 when unknown:
+		   processing modules forward it from their input to their output */
+		uint64_t getIngestTime() const {
+			return m_ingestTimeInUs;
+		}
+		void setIngestTime(uint64_t ingestTimeInUs) {
+			m_ingestTimeInUs = ingestTimeInUs;
+		}
+
+		/* room for the shared_ptr control block of pooled data */
+		typedef std::aligned_storage<64, alignof(std::max_align_t)>::type ControlBlockStorage;
+
 	private:
+		template<typename> friend class PacketAllocator;
+
 		uint64_t m_TimeIn180k;
+		uint64_t m_ingestTimeInUs = 0;
+		mutable std::atomic<uint64_t> m_traceId {0};
 		std::shared_ptr<const IMetadata> m_metadata;
+		ControlBlockStorage controlBlock; //used by PacketAllocator
 };
 
 typedef std::shared_ptr<const DataBase> Data;
 
+/**
+ * Runtime view of a data type, compared by pins when connecting. Exception handlers convert thrown pointers
+ * to base class pointers: this tells whether a type derives from another without knowing both at compile time.
+ */
+class DataTypeId {
+	public:
+		template<typename T>
+		static DataTypeId get() {
+			return DataTypeId(typeid(T), &throwPointer<T>, &catchesPointer<T>);
+		}
+
+		/* true when this type is 'base' or derives from it */
+		bool isA(const DataTypeId &base) const {
+			return base.catches(thrower);
+		}
+		const char* name() const {
+			return type->name();
+		}
+
+	private:
+		DataTypeId(const std::type_info &type, void (*thrower)(), bool (*catches)(void (*)()))
+			: type(&type), thrower(thrower), catches(catches) {
+		}
+
+		template<typename T>
+		static void throwPointer() {
+			throw static_cast<const T*>(nullptr);
+		}
+		template<typename T>
+		static bool catchesPointer(void (*thrower)()) {
+			try {
+				thrower();
+			} catch (const T*) {
+				return true;
+			} catch (...) {
+			}
+			return false;
+		}
+
+		const std::type_info *type;
+		void (*thrower)();
+		bool (*catches)(void (*)());
+};
+
 /* automatic inputs have a loose datatype */
 struct DataLoose : public DataBase {};
 
 class DataRaw : public DataBase {
 	public:
-		DataRaw(size_t size) : buffer(size) {}
+		/* the content is uninitialized */
+		DataRaw(size_t size, size_t alignment = BUFFER_ALIGNMENT_DEFAULT) : buffer(size, alignment) {}
 		uint8_t* data() override {
 			return buffer.data();
 		}
@@ -66,9 +151,12 @@ class DataRaw : public DataBase {
 		void resize(size_t size) override {
 			buffer.resize(size);
 		}
+		void setBufferArena(std::shared_ptr<IBufferArena> arena) {
+			buffer.setArena(std::move(arena));
+		}
 
 	private:
-		std::vector<uint8_t> buffer;
+		AlignedBuffer buffer;
 };
 
 }
@@ -0,0 +1,232 @@
+#include "huge_page_arena.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace Modules {
+
+namespace {
+const size_t PageSize = 4096;
+
+void prefault(uint8_t *base, size_t size) {
+	for (size_t i = 0; i < size; i += PageSize) {
+		base[i] = 0;
+	}
+}
+}
+
+const size_t HugePageArena::HugePageSize;
+
+HugePageArena::HugePageArena(size_t chunkSize)
+	: chunkSize(alignUp(chunkSize ? chunkSize : HugePageSize, HugePageSize)), usedBytes(0) {
+}
+
+HugePageArena::~HugePageArena() {
+	for (auto &chunk : chunks) {
+		unmapChunk(chunk);
+	}
+}
+
+void* HugePageArena::alloc(size_t size, size_t alignment) {
+	size = alignUp(size, BUFFER_ALIGNMENT_DEFAULT);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto it = freeBlocks.lower_bound(size); it != freeBlocks.end(); ++it) {
+		auto const p = it->second;
+		auto const blockSize = it->first;
+		auto const offset = alignUp((uintptr_t)p, alignment) - (uintptr_t)p;
+		if (offset + size > blockSize)
+			continue;
+		removeFreeBlock(freeBlocksByAddress.find(p));
+		if (offset)
+			addFreeBlock(p, offset);
+		if (blockSize - offset - size)
+			addFreeBlock(p + offset + size, blockSize - offset - size);
+		return allocBlock(findChunk(p), p + offset, size);
+	}
+
+	if (!chunks.empty()) {
+		auto &chunk = chunks.back();
+		auto const offset = alignUp((uintptr_t)(chunk.base + chunk.used), alignment) - (uintptr_t)chunk.base;
+		if (offset + size <= chunk.size) {
+			if (offset != chunk.used)
+				addFreeBlock(chunk.base + chunk.used, offset - chunk.used);
+			chunk.used = offset + size;
+			return allocBlock(chunk, chunk.base + offset, size);
+		}
+		//keep the tail of the current chunk for smaller requests
+		if (chunk.used < chunk.size)
+			addFreeBlock(chunk.base + chunk.used, chunk.size - chunk.used);
+		chunk.used = chunk.size;
+	}
+
+	chunks.push_back(mapChunk(alignUp(std::max(chunkSize, size + alignment), HugePageSize)));
+	auto &chunk = chunks.back();
+	auto const offset = alignUp((uintptr_t)chunk.base, alignment) - (uintptr_t)chunk.base;
+	if (offset)
+		addFreeBlock(chunk.base, offset);
+	chunk.used = offset + size;
+	return allocBlock(chunk, chunk.base + offset, size);
+}
+
+void HugePageArena::free(void *p, size_t /*size: the arena knows the actual block size*/) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto const block = allocatedBlocks.find((uint8_t*)p);
+	if (block == allocatedBlocks.end())
+		throw std::runtime_error("HugePageArena: freeing an unknown block.");
+	auto &chunk = findChunk(block->first);
+	auto begin = block->first, end = block->first + block->second;
+	chunk.allocatedBytes -= block->second;
+	usedBytes -= block->second;
+	allocatedBlocks.erase(block);
+
+	//coalesce with the free neighbours of the same chunk
+	auto next = freeBlocksByAddress.find(end);
+	if (next != freeBlocksByAddress.end() && end != chunk.base + chunk.size) {
+		end += next->second;
+		removeFreeBlock(next);
+	}
+	auto prev = freeBlocksByAddress.lower_bound(begin);
+	if (prev != freeBlocksByAddress.begin() && begin != chunk.base) {
+		--prev;
+		if (prev->first + prev->second == begin) {
+			begin = prev->first;
+			removeFreeBlock(prev);
+		}
+	}
+
+	if (&chunk == &chunks.back() && end == chunk.base + chunk.used)
+		chunk.used = begin - chunk.base; //back to the current chunk's tail
+	else
+		addFreeBlock(begin, end - begin);
+}
+
+void HugePageArena::trim() {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto chunk = chunks.begin();
+	while (chunk != chunks.end()) {
+		if (chunk->allocatedBytes) {
+			++chunk;
+			continue;
+		}
+		auto block = freeBlocksByAddress.lower_bound(chunk->base);
+		while (block != freeBlocksByAddress.end() && block->first < chunk->base + chunk->size) {
+			removeFreeBlock(block++);
+		}
+		unmapChunk(*chunk);
+		chunk = chunks.erase(chunk);
+	}
+}
+
+HugePageArena::Stats HugePageArena::getStats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	Stats stats;
+	memset(&stats, 0, sizeof(stats));
+	for (auto &chunk : chunks) {
+		stats.numChunks[chunk.backing]++;
+		stats.mappedBytes += chunk.size;
+	}
+	stats.usedBytes = usedBytes;
+	return stats;
+}
+
+HugePageArena::Chunk HugePageArena::mapChunk(size_t size) {
+	Chunk chunk;
+	chunk.size = size;
+	chunk.used = 0;
+	chunk.allocatedBytes = 0;
+#ifdef __linux__
+	auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+	if (p != MAP_FAILED) {
+		chunk.base = (uint8_t*)p;
+		chunk.backing = ExplicitHugePages;
+		return chunk;
+	}
+
+	//no reserved huge pages: over-map to align on a huge page boundary so that transparent huge pages can back the whole chunk
+	auto const mappedSize = size + HugePageSize;
+	p = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p != MAP_FAILED) {
+		chunk.base = (uint8_t*)alignUp((uintptr_t)p, HugePageSize);
+		auto const head = (size_t)(chunk.base - (uint8_t*)p);
+		if (head)
+			munmap(p, head);
+		if (mappedSize - head - size)
+			munmap(chunk.base + size, mappedSize - head - size);
+		chunk.backing = RegularPages;
+#ifdef MADV_HUGEPAGE
+		if (madvise(chunk.base, size, MADV_HUGEPAGE) == 0)
+			chunk.backing = TransparentHugePages;
+#endif
+		prefault(chunk.base, size);
+		return chunk;
+	}
+#endif
+
+	void *heap = nullptr;
+#ifdef _WIN32
+	heap = _aligned_malloc(size, HugePageSize);
+#else
+	if (posix_memalign(&heap, HugePageSize, size))
+		heap = nullptr;
+#endif
+	if (!heap)
+		throw std::bad_alloc();
+	chunk.base = (uint8_t*)heap;
+	chunk.backing = Heap;
+	prefault(chunk.base, size);
+	return chunk;
+}
+
+void HugePageArena::unmapChunk(const Chunk &chunk) {
+	if (chunk.backing == Heap) {
+#ifdef _WIN32
+		_aligned_free(chunk.base);
+#else
+		::free(chunk.base);
+#endif
+	} else {
+#ifdef __linux__
+		munmap(chunk.base, chunk.size);
+#endif
+	}
+}
+
+HugePageArena::Chunk& HugePageArena::findChunk(uint8_t *p) {
+	for (auto &chunk : chunks) {
+		if (p >= chunk.base && p < chunk.base + chunk.size)
+			return chunk;
+	}
+	throw std::runtime_error("HugePageArena: address out of the chunks.");
+}
+
+void* HugePageArena::allocBlock(Chunk &chunk, uint8_t *p, size_t size) {
+	allocatedBlocks[p] = size;
+	chunk.allocatedBytes += size;
+	usedBytes += size;
+	return p;
+}
+
+void HugePageArena::addFreeBlock(uint8_t *p, size_t size) {
+	freeBlocks.insert(std::make_pair(size, p));
+	freeBlocksByAddress[p] = size;
+}
+
+void HugePageArena::removeFreeBlock(std::map<uint8_t*, size_t>::iterator block) {
+	auto const sameSize = freeBlocks.equal_range(block->second);
+	for (auto it = sameSize.first; it != sameSize.second; ++it) {
+		if (it->second == block->first) {
+			freeBlocks.erase(it);
+			break;
+		}
+	}
+	freeBlocksByAddress.erase(block);
+}
+
+}
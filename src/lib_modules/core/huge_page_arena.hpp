@@ -0,0 +1,71 @@
+#pragma once
+
+#include "buffer.hpp"
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace Modules {
+
+/**
+ * Carves buffers out of large pre-faulted memory chunks, backed by huge pages when the system allows it:
+ * explicit huge pages (MAP_HUGETLB) first, then transparent huge pages (madvise), then regular pages, then
+ * the heap on systems without mmap. Fewer TLB misses when processing large pictures.
+ * Freed buffers are coalesced with their free neighbours and reused by later allocations, split to the
+ * requested size. Chunks without any buffer are unmapped by trim(), and all of them when the arena is
+ * destroyed, i.e. when the last buffer using it is released.
+ */
+class HugePageArena : public IBufferArena {
+	public:
+		static const size_t HugePageSize = 2 << 20;
+
+		enum Backing {
+			Heap,
+			RegularPages,
+			TransparentHugePages,
+			ExplicitHugePages,
+		};
+
+		struct Stats {
+			size_t numChunks[ExplicitHugePages + 1]; //indexed by Backing
+			size_t mappedBytes;
+			size_t usedBytes; //allocated and not freed
+		};
+
+		/* requests larger than the chunk size get a chunk of their own */
+		HugePageArena(size_t chunkSize = 32 << 20);
+		~HugePageArena();
+
+		void* alloc(size_t size, size_t alignment) override;
+		void free(void *p, size_t size) override;
+		void trim() override;
+
+		Stats getStats() const;
+
+	private:
+		HugePageArena(const HugePageArena&) = delete;
+		HugePageArena& operator= (const HugePageArena&) = delete;
+
+		struct Chunk {
+			uint8_t *base;
+			size_t size, used; //used: bytes carved out from the base
+			size_t allocatedBytes;
+			Backing backing;
+		};
+		Chunk mapChunk(size_t size);
+		void unmapChunk(const Chunk &chunk);
+		Chunk& findChunk(uint8_t *p);
+		void* allocBlock(Chunk &chunk, uint8_t *p, size_t size);
+		void addFreeBlock(uint8_t *p, size_t size);
+		void removeFreeBlock(std::map<uint8_t*, size_t>::iterator block);
+
+		size_t const chunkSize;
+		mutable std::mutex mutex;
+		std::vector<Chunk> chunks; //the last one is the current one
+		std::multimap<size_t, uint8_t*> freeBlocks; //by size
+		std::map<uint8_t*, size_t> freeBlocksByAddress; //same blocks: neighbours of the same chunk are never both free
+		std::map<uint8_t*, size_t> allocatedBlocks; //actual sizes: a reused free block may be larger than requested
+		size_t usedBytes;
+};
+
+}
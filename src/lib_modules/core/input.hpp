@@ -2,9 +2,12 @@
 
 #include "data.hpp"
 #include "metadata.hpp"
-#include "lib_signals/utils/queue.hpp"
+#include "lib_signals/utils/queue_lock_free.hpp"
 #include <atomic>
 #include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 
 namespace Modules {
@@ -29,30 +32,101 @@ class ConnectedCap {
 		std::atomic_size_t connections;
 };
 
-struct IInput : public IProcessor, public ConnectedCap, public MetadataCap, public Signals::Queue<Data> {
-	virtual ~IInput() noexcept(false) {}
+//the data queue defaults to Signals::Queue. Takes ownership of the queue.
+class IInput : public IProcessor, public ConnectedCap, public MetadataCap, public Signals::IQueue<Data> {
+	public:
+		IInput(Signals::IQueue<Data> *queue = nullptr) : queue(queue ? queue : new Signals::Queue<Data>) {}
+		virtual ~IInput() noexcept(false) {}
+
+		/* called when connecting an output. Returns false when the pushed data types must be checked one by one. */
+		virtual bool checkDataType(const DataTypeId &outputType) {
+			return true;
+		}
+
+		virtual void push(Data data) override {
+			queue->push(std::move(data));
+		}
+		virtual bool tryPop(Data &value) override {
+			return queue->tryPop(value);
+		}
+		virtual Data pop() override {
+			return queue->pop();
+		}
+		virtual void clear() override {
+			queue->clear();
+		}
+		virtual size_t tryPopN(std::vector<Data> &values, size_t maxItems) override {
+			return queue->tryPopN(values, maxItems);
+		}
+		virtual size_t popAll(std::vector<Data> &values) override {
+			return queue->popAll(values);
+		}
+
+	private:
+		std::unique_ptr<Signals::IQueue<Data>> const queue;
 };
 
+/**
+ * The data type is checked when connecting an output: the data is pushed without RTTI when the output data type
+ * derives from DataType. The data is checked on push before any connection, when an output may emit other types
+ * (e.g. its data type is a base of DataType), and always in debug builds.
+ */
 template<typename DataType, typename ModuleType = IProcessor>
 class Input : public IInput {
 	public:
-		Input(ModuleType * const module) : module(module) {}
+		Input(ModuleType * const module, Signals::IQueue<Data> *queue = nullptr)
+			: IInput(queue), module(module), checkPushedData(true), hasUncheckedOutput(false) {}
 
 		virtual void process() override {
 			module->process();
 		}
 
+		bool checkDataType(const DataTypeId &outputType) override {
+			auto const inputType = DataTypeId::get<DataType>();
+			if (std::is_same<DataType, DataLoose>::value || outputType.isA(inputType)) {
+				if (!hasUncheckedOutput)
+					checkPushedData = false;
+				return true;
+			} else if (inputType.isA(outputType)) {
+				hasUncheckedOutput = true;
+				checkPushedData = true;
+				return false;
+			} else {
+				throw std::runtime_error(format("Module connection: incompatible data types %s (output) and %s (input)", outputType.name(), inputType.name()));
+			}
+		}
+
 		virtual void push(Data data) override {
-			if (typeid(DataType) == typeid(DataLoose))
-				Signals::Queue<Data>::push(data);
+			if (std::is_same<DataType, DataLoose>::value || (!checkPushedData && !AlwaysCheckPushedData))
+				IInput::push(std::move(data));
 			else
-				Signals::Queue<Data>::push(safe_cast<const DataType>(data));
+				IInput::push(safe_cast<const DataType>(data));
 		}
 
 	private:
+#ifdef NDEBUG
+		static const bool AlwaysCheckPushedData = false;
+#else
+		static const bool AlwaysCheckPushedData = true;
+#endif
+
 		ModuleType * const module;
+		std::atomic_bool checkPushedData, hasUncheckedOutput;
 };
 
+/**
+ * Only for data popped from a typed Input<DataType>: its type was checked when connecting or when pushed.
+ * Dynamic inputs (ModuleDynI) are Input<DataLoose> and accept any data: use safe_cast on what they receive.
+ */
+template<typename DataType>
+std::shared_ptr<const DataType> input_cast(const Data &data) {
+#ifdef NDEBUG
+	return std::static_pointer_cast<const DataType>(data);
+#else
+	return safe_cast<const DataType>(data);
+#endif
+}
+
 struct IInputCap {
 	virtual ~IInputCap() noexcept(false) {}
 	virtual size_t getNumInputs() const = 0;
@@ -9,8 +9,9 @@ struct LogCap {
 	virtual ~LogCap() noexcept(false) {}
 
 	template<typename... Arguments>
-	void log(Level level, const std::string& fmt, Arguments... args) {
-		Log::msg(level, format("[%s] %s", typeid(*this).name(), format(fmt, args...)));
+	void log(Level level, const std::string& fmt, const Arguments&... args) {
+		if (Log::isEnabled(level))
+			Log::msg(level, "[%s] " + fmt, typeid(*this).name(), args...);
 	}
 
 	void setLogEnabled(bool enable) {
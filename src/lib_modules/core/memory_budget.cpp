@@ -0,0 +1,148 @@
+#include "memory_budget.hpp"
+#include <algorithm>
+
+namespace Modules {
+
+MemoryBudget::MemoryBudget(uint64_t limitInBytes, MemoryBudgetPolicy policy)
+	: limit(limitInBytes), policy(policy), usedBytes(0), peakBytes(0), trimmedBytes(0), numBlocked(0), numDropped(0), numSpilled(0),
+	  generation(0), numWaiters(0) {
+}
+
+MemoryBudget& MemoryBudget::global() {
+	static MemoryBudget budget;
+	return budget;
+}
+
+void MemoryBudget::setLimit(uint64_t limitInBytes) {
+	limit = limitInBytes;
+	notifyIdle();
+}
+
+void MemoryBudget::setPolicy(MemoryBudgetPolicy policy) {
+	this->policy = policy;
+}
+
+MemoryBudgetPolicy MemoryBudget::getPolicy() const {
+	return (MemoryBudgetPolicy)policy.load();
+}
+
+MemoryBudgetStats MemoryBudget::getStats() const {
+	MemoryBudgetStats stats;
+	stats.limit = limit;
+	stats.usedBytes = usedBytes;
+	stats.peakBytes = peakBytes;
+	stats.trimmedBytes = trimmedBytes;
+	stats.numBlocked = numBlocked;
+	stats.numDropped = numDropped;
+	stats.numSpilled = numSpilled;
+	return stats;
+}
+
+void MemoryBudget::registerClient(IMemoryBudgetClient *client) {
+	std::lock_guard<std::mutex> lock(clientsMutex);
+	clients.push_back(client);
+}
+
+void MemoryBudget::unregisterClient(IMemoryBudgetClient *client) {
+	std::lock_guard<std::mutex> lock(clientsMutex);
+	clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+}
+
+MemoryBudget::Result MemoryBudget::reserve(uint64_t bytes, const std::chrono::steady_clock::time_point *deadline, const std::atomic_bool &cancel) {
+	if (tryAdd(bytes))
+		return Granted;
+	trimClients();
+	if (tryAdd(bytes))
+		return Granted;
+
+	switch (getPolicy()) {
+	case MemoryBudgetDrop:
+		numDropped++;
+		return Denied;
+	case MemoryBudgetSpill:
+		numSpilled++;
+		return Spill;
+	default:
+		break;
+	}
+
+	numBlocked++;
+	std::unique_lock<std::mutex> lock(waitMutex);
+	numWaiters++;
+	auto result = Denied;
+	for (;;) {
+		auto const gen = generation;
+		lock.unlock();
+		std::atomic_thread_fence(std::memory_order_seq_cst); //pairs with notifyIdle(): either we trim the memory or we get notified
+		trimClients();
+		auto const granted = tryAdd(bytes);
+		lock.lock();
+		if (granted) {
+			result = Granted;
+			break;
+		}
+		if (cancel)
+			break;
+		bool timeout = false;
+		while (generation == gen && !cancel && !timeout) {
+			if (!deadline)
+				memoryReleased.wait(lock);
+			else
+				timeout = memoryReleased.wait_until(lock, *deadline) == std::cv_status::timeout;
+		}
+		if (timeout || cancel)
+			break;
+	}
+	numWaiters--;
+	return result;
+}
+
+void MemoryBudget::account(int64_t bytes) {
+	auto const used = usedBytes += bytes;
+	if (bytes > 0)
+		updatePeak(used);
+	else
+		notifyIdle();
+}
+
+void MemoryBudget::notifyIdle() {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (numWaiters > 0)
+		wakeUp();
+}
+
+void MemoryBudget::wakeUp() {
+	std::lock_guard<std::mutex> lock(waitMutex);
+	generation++;
+	memoryReleased.notify_all();
+}
+
+bool MemoryBudget::tryAdd(uint64_t bytes) {
+	auto const max = limit.load();
+	if (!max) {
+		updatePeak(usedBytes += bytes);
+		return true;
+	}
+	auto used = usedBytes.load();
+	do {
+		if (used + bytes > max)
+			return false;
+	} while (!usedBytes.compare_exchange_weak(used, used + bytes));
+	updatePeak(used + bytes);
+	return true;
+}
+
+void MemoryBudget::trimClients() {
+	std::lock_guard<std::mutex> lock(clientsMutex);
+	for (auto client : clients) {
+		trimmedBytes += client->trim();
+	}
+}
+
+void MemoryBudget::updatePeak(uint64_t used) {
+	auto peak = peakBytes.load();
+	while (used > peak && !peakBytes.compare_exchange_weak(peak, used)) {
+	}
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Modules {
+
+/* what an allocation that doesn't fit in the budget does once the idle memory was trimmed */
+enum MemoryBudgetPolicy {
+	MemoryBudgetBlock, //waits for memory to be released
+	MemoryBudgetDrop,  //fails: getBuffer() returns nullptr and the producer drops the data
+	MemoryBudgetSpill, //exceeds the budget with a heap block which is deleted, not pooled, when released
+};
+
+struct MemoryBudgetStats {
+	uint64_t limit;        //in bytes, 0 is unlimited
+	uint64_t usedBytes;
+	uint64_t peakBytes;
+	uint64_t trimmedBytes; //idle memory given back under pressure
+	uint64_t numBlocked, numDropped, numSpilled;
+};
+
+/* holds memory that can be given back under pressure, e.g. the idle blocks of an allocator */
+struct IMemoryBudgetClient {
+	virtual ~IMemoryBudgetClient() {}
+	/* returns the number of bytes released */
+	virtual uint64_t trim() = 0;
+};
+
+/**
+ * Bytes held by the allocators registered with the budget. When an allocation doesn't fit in the limit,
+ * the idle memory of all the clients is trimmed, then the policy applies.
+ */
+class MemoryBudget {
+	public:
+		enum Result {
+			Granted,
+			Denied,
+			Spill, //not accounted: the caller allocates outside of the budget
+		};
+
+		MemoryBudget(uint64_t limitInBytes = 0, MemoryBudgetPolicy policy = MemoryBudgetBlock);
+
+		/* the process-wide budget: every allocator registers with it. Unlimited by default. */
+		static MemoryBudget& global();
+
+		void setLimit(uint64_t limitInBytes);
+		void setPolicy(MemoryBudgetPolicy policy);
+		MemoryBudgetPolicy getPolicy() const;
+		MemoryBudgetStats getStats() const;
+
+		void registerClient(IMemoryBudgetClient *client);
+		void unregisterClient(IMemoryBudgetClient *client);
+
+		/* no deadline means forever. Waiting ends with Denied when 'cancel' is set and wakeUp() is called. */
+		Result reserve(uint64_t bytes, const std::chrono::steady_clock::time_point *deadline, const std::atomic_bool &cancel);
+		/* unconditional: memory that was allocated anyway (positive) or released (negative) */
+		void account(int64_t bytes);
+		/* signals the waiters that idle memory may be trimmed */
+		void notifyIdle();
+		void wakeUp();
+
+		bool hasWaiters() const {
+			return numWaiters > 0;
+		}
+
+	private:
+		MemoryBudget(const MemoryBudget&) = delete;
+		MemoryBudget& operator= (const MemoryBudget&) = delete;
+
+		bool tryAdd(uint64_t bytes);
+		void trimClients();
+		void updatePeak(uint64_t used);
+
+		std::atomic<uint64_t> limit;
+		std::atomic<int> policy;
+		std::atomic<uint64_t> usedBytes, peakBytes, trimmedBytes;
+		std::atomic<uint64_t> numBlocked, numDropped, numSpilled;
+
+		std::mutex clientsMutex;
+		std::vector<IMemoryBudgetClient*> clients;
+
+		std::mutex waitMutex;
+		std::condition_variable memoryReleased;
+		uint64_t generation; //protected by waitMutex: bumped on each notification
+		std::atomic<int> numWaiters;
+};
+
+}
@@ -2,6 +2,7 @@
 
 #include "data.hpp"
 #include "lib_utils/log.hpp"
+#include <atomic>
 #include <memory>
 #include <typeinfo>
 
@@ -23,8 +24,19 @@ enum StreamType {
 };
 
 struct IMetadata {
+	IMetadata() : generation(getNextMetadataGeneration()) {}
+	IMetadata(const IMetadata&) : generation(getNextMetadataGeneration()) {}
+	IMetadata& operator= (const IMetadata&) {
+		generation = getNextMetadataGeneration(); //the content changed
+		return *this;
+	}
 	virtual ~IMetadata() {}
 	virtual StreamType getStreamType() const = 0;
+
+	/* unique per metadata object and content (renewed on assignment), increasing: pins compare it rather than the metadata */
+	uint64_t getGeneration() const {
+		return generation;
+	}
 	bool isVideo() const {
 		switch (getStreamType()) {
 		case VIDEO_RAW: case VIDEO_PKT: return true;
@@ -37,6 +49,15 @@ struct IMetadata {
 		default: return false;
 		}
 	}
+
+private:
+	/* 0 means no metadata */
+	static uint64_t getNextMetadataGeneration() {
+		static std::atomic<uint64_t> generation(0);
+		return ++generation;
+	}
+
+	uint64_t generation;
 };
 
 static bool operator==(const IMetadata &left, const IMetadata &right) {
@@ -112,7 +133,7 @@ struct MetadataPktAudio : public MetadataPkt {
 
 class MetadataCap : public IMetadataCap {
 	public:
-		MetadataCap(IMetadata *metadata = nullptr) : m_metadata(metadata) {}
+		MetadataCap(IMetadata *metadata = nullptr) : m_metadata(metadata), m_generation(getGeneration(m_metadata.get())) {}
 		virtual ~MetadataCap() noexcept(false) {}
 
 		std::shared_ptr<const IMetadata> getMetadata() const override {
@@ -121,15 +142,18 @@ class MetadataCap : public IMetadataCap {
 
 		//Takes ownership.
 		void setMetadata(IMetadata *metadata) override {
-			m_metadata = std::shared_ptr<const IMetadata>(metadata);
+			assignMetadata(std::shared_ptr<const IMetadata>(metadata));
 		}
 		void setMetadata(std::shared_ptr<const IMetadata> metadata) override {
-			m_metadata = metadata;
+			assignMetadata(metadata);
 		}
 
-		bool updateMetadata(Data data) {
+		/* the steady state (the data carries the metadata last seen) compares generations and doesn't touch the reference counts */
+		bool updateMetadata(const Data &data) {
 			if (!data) {
 				return false;
+			} else if (m_generation && getGeneration(data->getMetadataPtr()) == m_generation) {
+				return false;
 			} else {
 				auto const metadata = data->getMetadata();
 				if (!metadata) {
@@ -139,7 +163,7 @@ class MetadataCap : public IMetadataCap {
 					if (m_metadata) {
 						if (*m_metadata == *metadata) {
 							Log::msg(Debug, "Output: metadata not equal but comparable by value. Updating.");
-							m_metadata = metadata;
+							assignMetadata(metadata);
 						} else {
 							Log::msg(Info, "Metadata update from data not supported yet: output pin and data won't carry the same metadata.");
 						}
@@ -148,7 +172,7 @@ class MetadataCap : public IMetadataCap {
 					Log::msg(Info, "Output: metadata transported by data changed. Updating.");
 					if (m_metadata && (metadata->getStreamType() != m_metadata->getStreamType()))
 						throw std::runtime_error(format("Metadata update: incompatible types %s for data and %s for attached", metadata->getStreamType(), m_metadata->getStreamType()));
-					m_metadata = metadata;
+					assignMetadata(metadata);
 					return true;
 				} else {
 					return false;
@@ -157,7 +181,16 @@ class MetadataCap : public IMetadataCap {
 		}
 
 	private:
+		void assignMetadata(std::shared_ptr<const IMetadata> metadata) {
+			m_metadata = std::move(metadata);
+			m_generation = getGeneration(m_metadata.get());
+		}
+		static uint64_t getGeneration(const IMetadata *metadata) {
+			return metadata ? metadata->getGeneration() : 0;
+		}
+
 		std::shared_ptr<const IMetadata> m_metadata;
+		uint64_t m_generation;
 };
 
 }
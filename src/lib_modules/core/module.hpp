@@ -40,6 +40,29 @@ class ModuleS : public IModule, public ErrorCap, public LogCap, public InputCap
 		}
 };
 
+//single input specialized module receiving the available data by batches (at most maxBatchSize items per call)
+class ModuleSBatch : public IModule, public ErrorCap, public LogCap, public InputCap {
+	public:
+		ModuleSBatch(size_t maxBatchSize = 64) : maxBatchSize(maxBatchSize) {}
+		virtual ~ModuleSBatch() noexcept(false) {}
+		virtual void process(span<Data> batch) = 0;
+		virtual void process() override {
+			//don't hold the blocks, even when process(batch) throws: they may outlive their allocator
+			struct Clear {
+				std::vector<Data> &batch;
+				~Clear() {
+					batch.clear();
+				}
+			} clear { batch };
+			if (getInput(0)->tryPopN(batch, maxBatchSize))
+				process(span<Data>(batch));
+		}
+
+	private:
+		size_t const maxBatchSize;
+		std::vector<Data> batch;
+};
+
 //dynamic input number specialized module
 //note: pins added automatically will carry the DataLoose type which doesn't
 //      allow to perform all safety checks ; consider adding pins manually if
@@ -3,6 +3,7 @@
 #include "allocator.hpp"
 #include "data.hpp"
 #include "metadata.hpp"
+#include "tracing.hpp"
 #include "lib_utils/log.hpp"
 #include "lib_utils/tools.hpp"
 #include <lib_signals/signals.hpp>
@@ -21,7 +22,13 @@ class IOutput {
 public:
 	virtual ~IOutput() noexcept(false) {}
 	virtual size_t emit(Data data) = 0;
+	virtual size_t emitBatch(span<const Data> batch) = 0;
 	virtual Signals::ISignal<void(Data)>& getSignal() = 0;
+	virtual AllocatorStats getAllocatorStats() const = 0;
+	/* the type of the data allocated by the output */
+	virtual DataTypeId getDataType() const = 0;
+	/* selects the memory of the blocks created from now on, e.g. a HugePageArena for large pictures: call before the first getBuffer() */
+	virtual void setBufferArena(std::shared_ptr<IBufferArena> arena) = 0;
 };
 
 template<typename Allocator, typename Signal>
@@ -38,21 +45,51 @@ class OutputT : public IOutput, public MetadataCap {
 
 		size_t emit(Data data) override {
 			updateMetadata(data);
+			if (Tracing::isEnabled() && data)
+				Tracing::onEmit(*data);
 			size_t numReceivers = signal.emit(data);
 			if (numReceivers == 0)
 				Log::msg(Debug, "emit(): Output had no receiver");
 			return numReceivers;
 		}
 
+		size_t emitBatch(span<const Data> batch) override {
+			for (auto &data : batch) {
+				updateMetadata(data);
+				if (Tracing::isEnabled() && data)
+					Tracing::onEmit(*data);
+			}
+			size_t numReceivers = signal.emitBatch(batch);
+			if (numReceivers == 0)
+				Log::msg(Debug, "emitBatch(): Output had no receiver");
+			return numReceivers;
+		}
+
 		template<typename T = typename Allocator::MyType>
 		std::shared_ptr<T> getBuffer(size_t size) {
 			return allocator->template getBuffer<T>(size);
 		}
+		template<typename T = typename Allocator::MyType>
+		std::shared_ptr<T> getBuffer(size_t size, std::chrono::microseconds timeout, AllocatorFallback fallback) {
+			return allocator->template getBuffer<T>(size, timeout, fallback);
+		}
 
 		Signals::ISignal<void(Data)>& getSignal() override {
 			return signal;
 		}
 
+		AllocatorStats getAllocatorStats() const override {
+			return allocator->getStats();
+		}
+
+		DataTypeId getDataType() const override {
+			return DataTypeId::get<typename Allocator::MyType>();
+		}
+
+		void setBufferArena(std::shared_ptr<IBufferArena> arena) override {
+			allocator->setBufferArena(std::move(arena));
+		}
+
 	private:
 		Signal signal;
 		std::unique_ptr<Allocator> allocator;
@@ -60,6 +97,7 @@ class OutputT : public IOutput, public MetadataCap {
 
 template<typename DataType> using OutputDataDefault = OutputT<PacketAllocator<DataType>, SignalDefaultSync>;
 typedef OutputDataDefault<DataRaw> OutputDefault;
+template<typename DataType> using OutputDataHugePages = OutputT<HugePagePacketAllocator<DataType>, SignalDefaultSync>;
 
 template <typename InstanceType, typename ...Args>
 InstanceType* createOutput(size_t allocatorSize, Args&&... args) {
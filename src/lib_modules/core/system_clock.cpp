@@ -23,6 +23,10 @@ IClock* createSystemClock() {
 	return new SystemClock;
 }
 
+uint64_t getWallClockInUs() {
+	return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
 static SystemClock systemClock;
 extern IClock* const g_DefaultClock = &systemClock;
 }
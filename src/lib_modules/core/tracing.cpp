@@ -0,0 +1,199 @@
+#include "tracing.hpp"
+#include "data.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace Modules {
+namespace Tracing {
+
+std::atomic_bool g_enabled(false);
+
+namespace {
+
+enum Phase {
+	Slice,     //a process() call
+	Emit,      //the data was emitted
+	FlowStart, //the data was queued for a module
+};
+
+struct Event {
+	const char *name;
+	Phase phase;
+	uint64_t timeInNs, durationInNs;
+	uint64_t traceId, flowId;
+};
+
+/* written by its thread only: the reader reads the 'count' first events */
+struct ThreadBuffer {
+	ThreadBuffer(size_t capacity, int tid) : events(capacity), count(0), numDropped(0), tid(tid) {}
+	std::vector<Event> events;
+	std::atomic<size_t> count;
+	std::atomic<uint64_t> numDropped;
+	int const tid;
+};
+
+struct Session {
+	std::mutex mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers; //never released: threads keep a pointer to theirs
+	std::set<std::string> names;
+	std::string path;
+	size_t maxEventsPerThread = 0;
+	bool atExitRegistered = false;
+	std::chrono::steady_clock::time_point startTime;
+	std::atomic<uint64_t> lastTraceId { 0 }, lastFlowId { 0 };
+};
+
+Session& getSession() {
+	static Session session;
+	return session;
+}
+
+thread_local ThreadBuffer *t_buffer = nullptr;
+thread_local uint64_t t_currentTraceId = 0; //the data being processed by this thread
+
+uint64_t nowInNs() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - getSession().startTime).count();
+}
+
+ThreadBuffer& getThreadBuffer() {
+	if (!t_buffer) {
+		auto &session = getSession();
+		std::lock_guard<std::mutex> lock(session.mutex);
+		session.buffers.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer(session.maxEventsPerThread, (int)session.buffers.size() + 1)));
+		t_buffer = session.buffers.back().get();
+	}
+	return *t_buffer;
+}
+
+void record(const Event &event) {
+	auto &buffer = getThreadBuffer();
+	auto const count = buffer.count.load(std::memory_order_relaxed);
+	if (count >= buffer.events.size()) {
+		buffer.numDropped++;
+		return;
+	}
+	buffer.events[count] = event;
+	buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void writeTime(std::ostream &out, const char *key, uint64_t timeInNs) {
+	out << ",\"" << key << "\":" << timeInNs / 1000 << "." << (char)('0' + timeInNs / 100 % 10) << (char)('0' + timeInNs / 10 % 10) << (char)('0' + timeInNs % 10);
+}
+
+void write(std::ostream &out, const Event &event, int tid) {
+	switch (event.phase) {
+	case Slice:
+		out << "{\"name\":\"" << event.name << "\",\"cat\":\"process\",\"ph\":\"X\"";
+		writeTime(out, "ts", event.timeInNs);
+		writeTime(out, "dur", event.durationInNs);
+		out << ",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"traceId\":" << event.traceId << "}}";
+		if (event.flowId) {
+			out << ",\n{\"name\":\"data\",\"cat\":\"data\",\"ph\":\"f\",\"bp\":\"e\",\"id\":" << event.flowId;
+			writeTime(out, "ts", event.timeInNs);
+			out << ",\"pid\":1,\"tid\":" << tid << "}";
+		}
+		break;
+	case Emit:
+		out << "{\"name\":\"emit\",\"cat\":\"data\",\"ph\":\"i\",\"s\":\"t\"";
+		writeTime(out, "ts", event.timeInNs);
+		out << ",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"traceId\":" << event.traceId << "}}";
+		break;
+	case FlowStart:
+		out << "{\"name\":\"data\",\"cat\":\"data\",\"ph\":\"s\",\"id\":" << event.flowId;
+		writeTime(out, "ts", event.timeInNs);
+		out << ",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"traceId\":" << event.traceId << "}}";
+		break;
+	}
+}
+
+void stopAtExit() {
+	stop();
+}
+
+}
+
+void start(const std::string &path, size_t maxEventsPerThread) {
+	auto &session = getSession();
+	{
+		std::lock_guard<std::mutex> lock(session.mutex);
+		session.path = path;
+		session.maxEventsPerThread = maxEventsPerThread;
+		session.startTime = std::chrono::steady_clock::now();
+		session.lastTraceId = 0;
+		session.lastFlowId = 0;
+		for (auto &buffer : session.buffers) {
+			buffer->count = 0;
+			buffer->numDropped = 0;
+		}
+		if (!session.atExitRegistered) {
+			std::atexit(&stopAtExit);
+			session.atExitRegistered = true;
+		}
+	}
+	g_enabled = true;
+}
+
+void stop() {
+	auto &session = getSession();
+	if (!g_enabled.exchange(false))
+		return;
+	std::lock_guard<std::mutex> lock(session.mutex);
+	std::ofstream out(session.path);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	uint64_t numDropped = 0;
+	for (auto &buffer : session.buffers) {
+		auto const count = buffer->count.load(std::memory_order_acquire);
+		if (!count)
+			continue;
+		out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+		first = false;
+		for (size_t i = 0; i < count; ++i) {
+			out << ",\n";
+			write(out, buffer->events[i], buffer->tid);
+		}
+		numDropped += buffer->numDropped;
+	}
+	out << "\n],\"otherData\":{\"numDroppedEvents\":" << numDropped << "}}\n";
+}
+
+const char* intern(const std::string &name) {
+	auto &session = getSession();
+	std::lock_guard<std::mutex> lock(session.mutex);
+	return session.names.insert(name).first->c_str();
+}
+
+void onEmit(const DataBase &data) {
+	auto traceId = data.getTraceId();
+	if (!traceId)
+		traceId = data.initTraceId(t_currentTraceId ? t_currentTraceId : ++getSession().lastTraceId);
+	record({ nullptr, Emit, nowInNs(), 0, traceId, 0 });
+}
+
+uint64_t onQueued(const DataBase &data) {
+	auto const flowId = ++getSession().lastFlowId;
+	record({ nullptr, FlowStart, nowInNs(), 0, data.getTraceId(), flowId });
+	return flowId;
+}
+
+void ProcessScope::begin(const char *name, uint64_t traceId, uint64_t flowId) {
+	this->name = name;
+	this->traceId = traceId;
+	this->flowId = flowId;
+	parentTraceId = t_currentTraceId;
+	t_currentTraceId = traceId;
+	startTimeInNs = nowInNs();
+}
+
+void ProcessScope::end() {
+	t_currentTraceId = parentTraceId;
+	record({ name, Slice, startTimeInNs, nowInNs() - startTimeInNs, traceId, flowId });
+}
+
+}
+}
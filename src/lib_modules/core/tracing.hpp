@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Modules {
+
+class DataBase;
+
+/**
+ * Opt-in per-data tracing: each emitted data is tagged with a trace ID, then its emission, its queuing and
+ * the process() calls are recorded and written in the Chrome trace event format (Perfetto, chrome://tracing).
+ * Each thread records into its own buffer: the recording path takes no lock. Disabled, a probe is a relaxed load.
+ */
+namespace Tracing {
+
+extern std::atomic_bool g_enabled;
+
+inline bool isEnabled() {
+	return g_enabled.load(std::memory_order_relaxed);
+}
+
+/* records until stop(), which writes the trace to 'path' - at the latest on exit. Events beyond the capacity are dropped. */
+void start(const std::string &path, size_t maxEventsPerThread = 1 << 16);
+void stop();
+
+/* the returned string stays valid until exit, even when the module it names is destroyed */
+const char* intern(const std::string &name);
+
+/* tags the data with the trace ID of the data processed by the calling thread, or a new one */
+void onEmit(const DataBase &data);
+/* returns the ID of the flow from the data being queued for a module to its processing */
+uint64_t onQueued(const DataBase &data);
+
+/* records a process() call as a slice */
+class ProcessScope {
+	public:
+		ProcessScope(const char *name, uint64_t traceId, uint64_t flowId) : name(nullptr) {
+			if (isEnabled())
+				begin(name, traceId, flowId);
+		}
+		~ProcessScope() {
+			if (name)
+				end();
+		}
+
+	private:
+		ProcessScope(const ProcessScope&) = delete;
+		ProcessScope& operator= (const ProcessScope&) = delete;
+
+		void begin(const char *name, uint64_t traceId, uint64_t flowId);
+		void end();
+
+		const char *name;
+		uint64_t traceId, flowId, startTimeInNs, parentTraceId;
+};
+
+}
+}
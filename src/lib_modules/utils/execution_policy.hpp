@@ -0,0 +1,33 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+
+namespace asio {
+class thread_pool;
+}
+
+namespace Modules {
+
+/* how the tasks of a module are executed */
+struct ExecutionPolicy {
+	enum Mode {
+		StrandedPool,    //non-concurrently in FIFO order, on the threads of a pool
+		DedicatedThread, //on a thread owned by the module
+		Synchronous,     //in the calling thread: a source runs in Pipeline::start()
+	};
+
+	ExecutionPolicy(Mode mode = StrandedPool, std::shared_ptr<asio::thread_pool> pool = nullptr, int cpu = -1)
+		: mode(mode), pool(pool), cpu(cpu) {
+	}
+
+	Mode mode;
+	std::shared_ptr<asio::thread_pool> pool; //StrandedPool: nullptr is the default pool, created on first use
+	int cpu;                                 //DedicatedThread: CPU index the thread is pinned to, negative leaves it unpinned
+};
+
+/* numThreads=0 is one thread per CPU. cpuAffinity: optional CPU index per thread (negative leaves the thread unpinned) */
+std::shared_ptr<asio::thread_pool> createThreadPool(unsigned numThreads, const std::vector<int> &cpuAffinity = std::vector<int>());
+
+}
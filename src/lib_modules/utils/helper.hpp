@@ -48,12 +48,13 @@ size_t ConnectOutputToInput(IOutput* prev, ModuleType* next, IProcessExecutor *
 		}
 	}
 
+	next->checkDataType(prev->getDataType());
 	next->connect();
 	return prev->getSignal().connect(
 		[=](Data data)
 	{
-		next->push(data);
-		(*executor)(MEMBER_FUNCTOR_PROCESS(next));
+		next->push(std::move(data));
+		executor->post(MEMBER_FUNCTOR_PROCESS(next));
 	}
 	);
 }
@@ -69,6 +70,50 @@ size_t ConnectModules(ModuleType1 *prev, size_t outputIdx, ModuleType2 *next, si
 	return ConnectOutputToInput(output, next->getInput(inputIdx), executor);
 }
 
+/* slot calling a single-input module synchronously: no input queue, no executor, no virtual call */
+template<typename ModuleType>
+class ModuleSlot {
+	public:
+		explicit ModuleSlot(ModuleType *module) : module(module) {
+		}
+
+		void operator()(Data data) const {
+			module->ModuleType::process(data);
+		}
+
+	private:
+		ModuleType *module;
+};
+
+/* data bypasses the inputs of static connections: it can't be checked one by one */
+inline void checkStaticDataType(IInput *input, const DataTypeId &outputType) {
+	if (!input->checkDataType(outputType))
+		throw std::runtime_error(format("Module static connection: data type %s may not be converted", outputType.name()));
+}
+
+/* fixed topology: the modules are called in order by a compile-time signal, which is the only dynamic connection of 'prev' */
+template<typename... ModuleTypes>
+size_t ConnectOutputToModulesStatic(IOutput* prev, ModuleTypes*... next) {
+	auto const dataType = prev->getDataType();
+	int unused[] = { 0, (checkStaticDataType(next->getInput(0), dataType), next->getInput(0)->connect(), 0)... };
+	(void)unused;
+	auto modules = Signals::makeStaticSignal(ModuleSlot<ModuleTypes>(next)...);
+	return prev->getSignal().connect([modules](Data data) mutable {
+		modules.emit(data);
+	});
+}
+
+/* static chain: connects the first output of each module to the next module */
+template<typename ModuleType>
+void ConnectModulesStatic(ModuleType*) {
+}
+
+template<typename PrevType, typename NextType, typename... ModuleTypes>
+void ConnectModulesStatic(PrevType *prev, NextType *next, ModuleTypes*... others) {
+	ConnectOutputToModulesStatic(prev->getOutput(0), next);
+	ConnectModulesStatic(next, others...);
+}
+
 template <typename T = IMetadata>
 std::shared_ptr<const T> getMetadataFromOutput(IOutput const * const out) {
 	auto const metadata = safe_cast<const IMetadataCap>(out)->getMetadata();
@@ -1,12 +1,17 @@
 #include "pipeline.hpp"
 #include "stranded_pool_executor.hpp"
+#include "lib_utils/histogram.hpp"
+#include "lib_utils/profiler.hpp"
+#include "lib_signals/utils/queue.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 #include <typeinfo>
 #include "helper.hpp"
-
-#define EXECUTOR_SYNC         Signals::ExecutorSync<void()>
-#define EXECUTOR_ASYNC_THREAD Signals::ExecutorThread<void()>
-#define EXECUTOR_ASYNC_POOL   StrandedPoolModuleExecutor
-#define EXECUTOR EXECUTOR_ASYNC_POOL
+#ifdef __GNUC__
+#include <cxxabi.h>
+#endif
 
 using namespace Modules;
 
@@ -18,25 +23,116 @@ Signals::MemberFunctor<void, Class, void(Class::*)()>
 MEMBER_FUNCTOR_NOTIFY_FINISHED(Class* objectPtr) {
 	return Signals::MemberFunctor<void, Class, void(Class::*)()>(objectPtr, &ICompletionNotifier::finished);
 }
+
+int64_t nowInUs() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string getName(const IModule &module) {
+	auto const name = typeid(module).name();
+#ifdef __GNUC__
+	int status = 0;
+	std::unique_ptr<char, void(*)(void*)> demangled(abi::__cxa_demangle(name, nullptr, nullptr, &status), &free);
+	if (status == 0)
+		return demangled.get();
+#endif
+	return name;
+}
 }
 
-/* Wrapper around the module's inputs. Data is queued in the calling thread, then always dispatched by the executor. */
+/* Counters of a module: updated from the producer threads (input, output) and from the executor (processing). */
+class ModuleMetrics {
+	public:
+		ModuleMetrics()
+			: numPacketsIn(0), numPacketsOut(0), numBytesIn(0), numBytesOut(0), queueDepth(0), maxQueueDepth(0),
+			  processTimeInUs(0), cpuTimeInUs(0), queueWaitTimeInUs(0) {
+		}
+
+		void onInput(const Data &data) {
+			numPacketsIn++;
+			numBytesIn += data->size();
+			auto const depth = ++queueDepth;
+			auto max = maxQueueDepth.load();
+			while (depth > max && !maxQueueDepth.compare_exchange_weak(max, depth)) {
+			}
+		}
+
+		void onOutput(const Data &data) {
+			if (data) {
+				numPacketsOut++;
+				numBytesOut += data->size();
+			}
+		}
+
+		/* 'enqueueTimeInUs' is negative when the call doesn't process an input data */
+		template<typename Processor>
+		void process(Processor *processor, int64_t enqueueTimeInUs) {
+			auto const startTimeInUs = nowInUs();
+			auto const startCpuTimeInUs = Tools::getThreadCpuTimeInUs();
+			if (enqueueTimeInUs >= 0) {
+				queueWaitTimeInUs += startTimeInUs - enqueueTimeInUs;
+				queueDepth--;
+			}
+			processor->process();
+			processTimeInUs += nowInUs() - startTimeInUs;
+			cpuTimeInUs += Tools::getThreadCpuTimeInUs() - startCpuTimeInUs;
+		}
+
+		ModuleStats get() const {
+			ModuleStats stats;
+			stats.numPacketsIn = numPacketsIn;
+			stats.numPacketsOut = numPacketsOut;
+			stats.numBytesIn = numBytesIn;
+			stats.numBytesOut = numBytesOut;
+			stats.queueDepth = queueDepth;
+			stats.maxQueueDepth = maxQueueDepth;
+			stats.processTimeInUs = processTimeInUs;
+			stats.cpuTimeInUs = cpuTimeInUs;
+			stats.queueWaitTimeInUs = queueWaitTimeInUs;
+			return stats;
+		}
+
+	private:
+		std::atomic<uint64_t> numPacketsIn, numPacketsOut, numBytesIn, numBytesOut;
+		std::atomic<uint64_t> queueDepth, maxQueueDepth;
+		std::atomic<uint64_t> processTimeInUs, cpuTimeInUs, queueWaitTimeInUs;
+};
+
+/* Wrapper around the module's inputs. Data is queued in the calling thread, then always dispatched by the executor.
+   A fused module uses a synchronous executor: it is processed in the calling thread.
+   On sinks, 'latency' records the end-to-end latency of the data carrying an ingest time. */
 class PipelinedInput : public IInput {
 	public:
-		PipelinedInput(IInput *input, IProcessExecutor &executor, ICompletionNotifier * const notify)
-			: delegate(input), notify(notify), executor(executor) {}
+		PipelinedInput(IInput *input, const char *name, IProcessExecutor &executor, ICompletionNotifier * const notify, ModuleMetrics &metrics, Histogram *latency)
+			: delegate(input), name(name), notify(notify), executor(&executor), metrics(metrics), latency(latency) {}
 		virtual ~PipelinedInput() noexcept(false) {}
 
 		/* receiving nullptr stops the execution */
 		virtual void process() override {
 			auto data = pop();
 			if (data) {
-				Log::msg(Debug, format("Module %s: dispatch data for time %s", typeid(delegate).name(), data->getTime() / (double)IClock::Rate));
-				delegate->push(data);
-				executor(MEMBER_FUNCTOR_PROCESS(delegate));
+				Log::msg(Debug, "Module %s: dispatch data for time %s", typeid(delegate).name(), data->getTime() / (double)IClock::Rate);
+				metrics.onInput(data);
+				uint64_t traceId = 0;
+				if (Tracing::isEnabled() && data->getTraceId()) {
+					traceId = data->getTraceId();
+					flowIds.push(Tracing::onQueued(*data));
+				}
+				auto const ingestTime = latency ? data->getIngestTime() : 0;
+				delegate->push(std::move(data));
+				auto const enqueueTimeInUs = nowInUs();
+				//the captures must fit in the task: the flow IDs are queued aside (the dispatch order is the queuing order)
+				executor->post([this, enqueueTimeInUs, traceId, ingestTime]() {
+					Tracing::ProcessScope scope(name, traceId, traceId ? flowIds.pop() : 0);
+					metrics.process(delegate, enqueueTimeInUs);
+					if (ingestTime) {
+						auto const now = getWallClockInUs();
+						latency->record(now > ingestTime ? now - ingestTime : 0);
+					}
+				});
 			} else {
-				Log::msg(Debug, format("Module %s: notify finished.", typeid(delegate).name()));
-				executor(MEMBER_FUNCTOR_NOTIFY_FINISHED(notify));
+				Log::msg(Debug, "Module %s: notify finished.", typeid(delegate).name());
+				executor->post(MEMBER_FUNCTOR_NOTIFY_FINISHED(notify));
 			}
 		}
 
@@ -46,19 +142,30 @@ class PipelinedInput : public IInput {
 		virtual void connect() override {
 			delegate->connect();
 		}
+		virtual bool checkDataType(const DataTypeId &outputType) override {
+			return delegate->checkDataType(outputType);
+		}
+
+		void setExecutor(IProcessExecutor &executor) {
+			this->executor = &executor;
+		}
 
 	private:
 		IInput *delegate;
+		const char * const name;
 		ICompletionNotifier * const notify;
-		IProcessExecutor &executor;
+		IProcessExecutor *executor;
+		ModuleMetrics &metrics;
+		Histogram * const latency;
+		Signals::Queue<uint64_t> flowIds; //of the traced data
 };
 
 /* Wrapper around the module. */
 class PipelinedModule : public ICompletionNotifier, public IPipelinedModule, public InputCap {
 public:
 	/* take ownership of module */
-	PipelinedModule(IModule *module, ICompletionNotifier *notify)
-		: delegate(module), localExecutor(new EXECUTOR), executor(*localExecutor), m_notify(notify) {
+	PipelinedModule(IModule *module, ICompletionNotifier *notify, const ExecutionPolicy &policy)
+		: delegate(module), name(Tracing::intern(getName(*module))), localExecutor(createExecutor(policy)), executor(localExecutor.get()), m_notify(notify) {
 	}
 	~PipelinedModule() noexcept(false) {}
 
@@ -88,17 +195,63 @@ public:
 		return delegate->getNumOutputs() == 0;
 	}
 
+	ModuleStats getStats() const override {
+		auto stats = metrics.get();
+		stats.name = name;
+		for (auto &latency : latencies) {
+			stats.latencies.push_back({ latency->getCount(), latency->getPercentile(50), latency->getPercentile(99), latency->getMax(), latency->getSum() });
+		}
+		return stats;
+	}
+
+	/* counts the data emitted on output 'i' */
+	void instrumentOutput(size_t i) {
+		std::lock_guard<std::mutex> lock(outputsMutex);
+		if (i < instrumentedOutputs.size() && instrumentedOutputs[i])
+			return;
+		if (i >= instrumentedOutputs.size())
+			instrumentedOutputs.resize(i + 1, false);
+		instrumentedOutputs[i] = true;
+		auto const metrics = &this->metrics;
+		getOutput(i)->getSignal().connect([metrics](Data data) {
+			metrics->onOutput(data);
+		});
+	}
+
 private:
 	void connect(IOutput *output, size_t inputIdx) override {
 		ConnectOutputToInput(output, getInput(inputIdx), &g_executorSync);
 	}
 
+	void fuse(IPipelinedModule *upstream) override {
+		if (isSource())
+			throw std::runtime_error(format("PipelinedModule %s: a source can't be fused.", typeid(delegate).name()));
+		Log::msg(Debug, "Module %s: fused with upstream module", typeid(delegate).name());
+		this->upstream = safe_cast<PipelinedModule>(upstream);
+		executor = &g_executorSync;
+		mimicInputs();
+		for (auto &input : inputs) {
+			safe_cast<PipelinedInput>(input.get())->setExecutor(*executor);
+		}
+		localExecutor.reset(); //never used: e.g. a dedicated thread would stay idle
+	}
+
+	/* the executor of the first module of the fused chain */
+	IProcessExecutor& getUnitExecutor() {
+		return upstream ? upstream->getUnitExecutor() : *localExecutor;
+	}
+
 	void mimicInputs() {
 		auto const delegateInputs = delegate->getNumInputs();
 		auto const thisInputs = inputs.size();
 		if (thisInputs < delegateInputs) {
 			for (size_t i = thisInputs; i < delegateInputs; ++i) {
-				addInput(new PipelinedInput(delegate->getInput(i), this->executor, this));
+				Histogram *latency = nullptr;
+				if (isSink()) {
+					latencies.push_back(uptr(new Histogram));
+					latency = latencies.back().get();
+				}
+				addInput(new PipelinedInput(delegate->getInput(i), name, *executor, this, metrics, latency));
 			}
 		}
 	}
@@ -112,7 +265,7 @@ private:
 
 	/* uses the executor (i.e. may defer the call) */
 	void process() override {
-		Log::msg(Debug, format("Module %s: dispatch data", typeid(delegate).name()));
+		Log::msg(Debug, "Module %s: dispatch data", typeid(delegate).name());
 
 		if (isSource()) {
 			if (getNumInputs() == 0) {
@@ -120,8 +273,11 @@ private:
 				delegate->addInput(new Input<DataLoose>(delegate.get()));
 				getInput(0)->push(nullptr);
 				delegate->getInput(0)->push(nullptr);
-				executor(MEMBER_FUNCTOR_PROCESS(delegate.get()));
-				executor(MEMBER_FUNCTOR_PROCESS(getInput(0)));
+				executor->post([this]() {
+					Tracing::ProcessScope scope(name, 0, 0);
+					metrics.process(delegate.get(), -1);
+				});
+				executor->post(MEMBER_FUNCTOR_PROCESS(getInput(0)));
 				return;
 			} else {
 				/*the source is likely processing: push null in the loop to exit and let things follow their way*/
@@ -140,7 +296,12 @@ private:
 	void finished() override {
 		delegate->flush();
 		if (isSink()) {
-			m_notify->finished();
+			if (upstream) {
+				/*the upstream modules are still on the stack: notify once they have returned*/
+				getUnitExecutor().post(MEMBER_FUNCTOR_NOTIFY_FINISHED(m_notify));
+			} else {
+				m_notify->finished();
+			}
 		} else {
 			for (size_t i = 0; i < delegate->getNumOutputs(); ++i) {
 				delegate->getOutput(i)->emit(nullptr);
@@ -149,16 +310,24 @@ private:
 	}
 
 	std::unique_ptr<IModule> delegate;
-	std::unique_ptr<IProcessExecutor> const localExecutor;
-	IProcessExecutor &executor;
+	const char * const name;
+	std::unique_ptr<IProcessExecutor> localExecutor; //released when fused
+	IProcessExecutor *executor;
+	PipelinedModule *upstream = nullptr;
 	ICompletionNotifier* const m_notify;
+	ModuleMetrics metrics;
+	std::vector<std::unique_ptr<Histogram>> latencies; //sinks: one per input
+	std::mutex outputsMutex;
+	std::vector<bool> instrumentedOutputs; //protected by outputsMutex
 };
 
-Pipeline::Pipeline(bool isLowLatency) : isLowLatency(isLowLatency), numRemainingNotifications(0) {
+Pipeline::Pipeline(bool isLowLatency, const ExecutionPolicy &policy)
+	: isLowLatency(isLowLatency), autoFusion(false), defaultPolicy(policy), allocatorStatsPeriod(0), statsPeriod(0), statsFormat(StatsJsonLines),
+	  numRemainingNotifications(0) {
 }
 
-IPipelinedModule* Pipeline::addModuleInternal(IModule *rawModule) {
-	auto module = uptr(new PipelinedModule(rawModule, this));
+IPipelinedModule* Pipeline::addModuleInternal(IModule *rawModule, const ExecutionPolicy &policy) {
+	auto module = uptr(new PipelinedModule(rawModule, this, policy));
 	auto ret = module.get();
 	modules.push_back(std::move(module));
 	return ret;
@@ -169,10 +338,50 @@ void Pipeline::connect(IModule *prev, size_t outputIdx, IModule *n, size_t input
 	if (next->isSink())
 		numRemainingNotifications++;
 	next->connect(prev->getOutput(outputIdx), inputIdx);
+	if (auto pipelinedPrev = dynamic_cast<PipelinedModule*>(prev))
+		pipelinedPrev->instrumentOutput(outputIdx);
+	connections.push_back({ prev, n });
+}
+
+void Pipeline::fuse(IModule *module) {
+	fusionHints.push_back(module);
+}
+
+void Pipeline::setAutoFusion(bool enable) {
+	autoFusion = enable;
+}
+
+void Pipeline::applyFusion() {
+	auto numConnections = [&](IModule *module, IModule * Connection::*end) {
+		return std::count_if(connections.begin(), connections.end(), [&](const Connection &c) {
+			return c.*end == module;
+		});
+	};
+
+	for (auto hint : fusionHints) {
+		auto c = std::find_if(connections.begin(), connections.end(), [&](const Connection &c) {
+			return c.next == hint;
+		});
+		if (numConnections(hint, &Connection::next) != 1)
+			throw std::runtime_error("Pipeline: only a module with a single connected input can be fused.");
+		safe_cast<IPipelinedModule>(hint)->fuse(safe_cast<IPipelinedModule>(c->prev));
+	}
+	fusionHints.clear();
+
+	if (!autoFusion)
+		return;
+	for (auto &c : connections) {
+		auto next = safe_cast<IPipelinedModule>(c.next);
+		if (next->isSource() || next->getNumInputs() != 1)
+			continue;
+		if (numConnections(c.next, &Connection::next) == 1 && numConnections(c.prev, &Connection::prev) == 1)
+			next->fuse(safe_cast<IPipelinedModule>(c.prev));
+	}
 }
 
 void Pipeline::start() {
 	Log::msg(Info, "Pipeline: starting");
+	applyFusion();
 	for (auto &m : modules) {
 		if (m->isSource())
 			m->process();
@@ -183,14 +392,178 @@ void Pipeline::start() {
 void Pipeline::waitForCompletion() {
 	Log::msg(Info, "Pipeline: waiting for completion (remaning: %s)", (int)numRemainingNotifications);
 	std::unique_lock<std::mutex> lock(mutex);
+	auto const start = std::chrono::steady_clock::now();
+	auto nextAllocatorStatsDump = start + allocatorStatsPeriod, nextStatsDump = start + statsPeriod;
 	while (numRemainingNotifications > 0) {
-		condition.wait(lock);
+		if (allocatorStatsPeriod.count() == 0 && statsPeriod.count() == 0) {
+			condition.wait(lock);
+			continue;
+		}
+		auto next = allocatorStatsPeriod.count() ? nextAllocatorStatsDump : nextStatsDump;
+		if (allocatorStatsPeriod.count() && statsPeriod.count())
+			next = std::min(nextAllocatorStatsDump, nextStatsDump);
+		if (condition.wait_until(lock, next) == std::cv_status::timeout) {
+			auto const now = std::chrono::steady_clock::now();
+			if (allocatorStatsPeriod.count() && now >= nextAllocatorStatsDump) {
+				dumpAllocatorStats();
+				nextAllocatorStatsDump = now + allocatorStatsPeriod;
+			}
+			if (statsPeriod.count() && now >= nextStatsDump) {
+				dumpStats();
+				logLatencies();
+				nextStatsDump = now + statsPeriod;
+			}
+		}
 	}
 	Log::msg(Info, "Pipeline: completed");
+	if (allocatorStatsPeriod.count() > 0)
+		dumpAllocatorStats();
+	if (statsPeriod.count() > 0)
+		dumpStats();
+	logLatencies();
+}
+
+void Pipeline::dumpAllocatorStats() const {
+	for (size_t m = 0; m < modules.size(); ++m) {
+		for (size_t i = 0; i < modules[m]->getNumOutputs(); ++i) {
+			auto const stats = modules[m]->getOutput(i)->getAllocatorStats();
+			Log::msg(Info, "Pipeline: module %s output %s: %s/%s blocks in flight (high-water mark %s), %s bytes, %s resizes, %s heap fallbacks, blocked %s ms",
+				m, i, stats.numBlocksInFlight, stats.numBlocks, stats.highWaterMark, stats.numBytes, stats.numResizes, stats.numHeapFallbacks, stats.blockedTimeInUs / 1000.0);
+		}
+	}
+	auto const budget = MemoryBudget::global().getStats();
+	if (budget.limit)
+		Log::msg(Info, "Pipeline: memory budget: %s/%s bytes (peak %s), %s bytes trimmed, %s blocked, %s dropped, %s spilled",
+			budget.usedBytes, budget.limit, budget.peakBytes, budget.trimmedBytes, budget.numBlocked, budget.numDropped, budget.numSpilled);
+}
+
+void Pipeline::setAllocatorStatsPeriod(std::chrono::milliseconds period) {
+	allocatorStatsPeriod = period;
+}
+
+std::vector<ModuleStats> Pipeline::getStats() const {
+	std::vector<ModuleStats> stats;
+	for (auto &m : modules) {
+		stats.push_back(m->getStats());
+	}
+	return stats;
+}
+
+void Pipeline::setStatsDump(const std::string &path, std::chrono::milliseconds period, StatsFormat format) {
+	statsPath = path;
+	statsPeriod = period;
+	statsFormat = format;
+}
+
+namespace {
+std::string escape(const std::string &str) {
+	std::string escaped;
+	for (auto c : str) {
+		if (c == '"' || c == '\\')
+			escaped += '\\';
+		escaped += c;
+	}
+	return escaped;
+}
+
+void writeJsonLine(std::ostream &out, const std::vector<ModuleStats> &stats) {
+	out << "{\"timeInMs\":" << nowInUs() / 1000 << ",\"modules\":[";
+	for (size_t m = 0; m < stats.size(); ++m) {
+		auto const &s = stats[m];
+		out << (m ? "," : "") << "{\"index\":" << m << ",\"name\":\"" << escape(s.name) << "\""
+		    << ",\"packetsIn\":" << s.numPacketsIn << ",\"packetsOut\":" << s.numPacketsOut
+		    << ",\"bytesIn\":" << s.numBytesIn << ",\"bytesOut\":" << s.numBytesOut
+		    << ",\"queueDepth\":" << s.queueDepth << ",\"maxQueueDepth\":" << s.maxQueueDepth
+		    << ",\"processTimeInUs\":" << s.processTimeInUs << ",\"cpuTimeInUs\":" << s.cpuTimeInUs
+		    << ",\"queueWaitTimeInUs\":" << s.queueWaitTimeInUs;
+		if (!s.latencies.empty()) {
+			out << ",\"latencies\":[";
+			for (size_t i = 0; i < s.latencies.size(); ++i) {
+				auto const &l = s.latencies[i];
+				out << (i ? "," : "") << "{\"input\":" << i << ",\"samples\":" << l.numSamples << ",\"p50InUs\":" << l.p50InUs
+				    << ",\"p99InUs\":" << l.p99InUs << ",\"maxInUs\":" << l.maxInUs << "}";
+			}
+			out << "]";
+		}
+		out << "}";
+	}
+	out << "]}\n";
+}
+
+void writePrometheus(std::ostream &out, const std::vector<ModuleStats> &stats) {
+	struct Metric {
+		const char *name, *type;
+		uint64_t ModuleStats::*value;
+	};
+	static const Metric metrics[] = {
+		{ "signals_module_packets_in_total", "counter", &ModuleStats::numPacketsIn },
+		{ "signals_module_packets_out_total", "counter", &ModuleStats::numPacketsOut },
+		{ "signals_module_bytes_in_total", "counter", &ModuleStats::numBytesIn },
+		{ "signals_module_bytes_out_total", "counter", &ModuleStats::numBytesOut },
+		{ "signals_module_queue_depth", "gauge", &ModuleStats::queueDepth },
+		{ "signals_module_queue_depth_max", "gauge", &ModuleStats::maxQueueDepth },
+		{ "signals_module_process_time_us_total", "counter", &ModuleStats::processTimeInUs },
+		{ "signals_module_cpu_time_us_total", "counter", &ModuleStats::cpuTimeInUs },
+		{ "signals_module_queue_wait_time_us_total", "counter", &ModuleStats::queueWaitTimeInUs },
+	};
+	for (auto &metric : metrics) {
+		out << "# TYPE " << metric.name << " " << metric.type << "\n";
+		for (size_t m = 0; m < stats.size(); ++m) {
+			out << metric.name << "{index=\"" << m << "\",module=\"" << escape(stats[m].name) << "\"} " << stats[m].*metric.value << "\n";
+		}
+	}
+
+	auto const latency = "signals_sink_latency_us";
+	out << "# TYPE " << latency << " summary\n";
+	for (size_t m = 0; m < stats.size(); ++m) {
+		for (size_t i = 0; i < stats[m].latencies.size(); ++i) {
+			auto const &l = stats[m].latencies[i];
+			auto const labels = format("index=\"%s\",module=\"%s\",input=\"%s\"", m, escape(stats[m].name), i);
+			out << latency << "{" << labels << ",quantile=\"0.5\"} " << l.p50InUs << "\n";
+			out << latency << "{" << labels << ",quantile=\"0.99\"} " << l.p99InUs << "\n";
+			out << latency << "{" << labels << ",quantile=\"1\"} " << l.maxInUs << "\n";
+			out << latency << "_sum{" << labels << "} " << l.totalInUs << "\n";
+			out << latency << "_count{" << labels << "} " << l.numSamples << "\n";
+		}
+	}
+}
+}
+
+void Pipeline::dumpStats() const {
+	if (statsPath.empty())
+		return;
+	auto const stats = getStats();
+	if (statsFormat == StatsJsonLines) {
+		std::ofstream file(statsPath, std::ios::app);
+		writeJsonLine(file, stats);
+	} else {
+		//scrapers must not read a partial file
+		auto const tmpPath = statsPath + ".tmp";
+		{
+			std::ofstream file(tmpPath, std::ios::trunc);
+			writePrometheus(file, stats);
+		}
+#ifdef _WIN32
+		std::remove(statsPath.c_str()); //rename() doesn't replace existing files
+#endif
+		std::rename(tmpPath.c_str(), statsPath.c_str());
+	}
+}
+
+void Pipeline::logLatencies() const {
+	auto const stats = getStats();
+	for (size_t m = 0; m < stats.size(); ++m) {
+		for (size_t i = 0; i < stats[m].latencies.size(); ++i) {
+			auto const &l = stats[m].latencies[i];
+			if (l.numSamples)
+				Log::msg(Info, "Pipeline: module %s (%s) input %s: latency p50 %s ms, p99 %s ms, max %s ms (%s data)",
+					m, stats[m].name, i, l.p50InUs / 1000.0, l.p99InUs / 1000.0, l.maxInUs / 1000.0, l.numSamples);
+		}
+	}
 }
 
 void Pipeline::exitSync() {
-	Log::msg(Warning, format("Pipeline: asked to exit now."));
+	Log::msg(Warning, "Pipeline: asked to exit now.");
 	for (auto &m : modules) {
 		if (m->isSource())
 			m->process();
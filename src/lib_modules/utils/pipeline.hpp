@@ -1,7 +1,10 @@
 #pragma once
 
 #include "../core/module.hpp"
+#include "execution_policy.hpp"
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 
@@ -12,10 +15,37 @@ InstanceType* createModule(size_t allocatorSize, Args&&... args) {
 	return new Modules::ModuleDefault<InstanceType>(allocatorSize, std::forward<Args>(args)...);
 }
 
+/* end-to-end latency of the data reaching a sink input: from its ingest by the source (see DataBase::getIngestTime()) to the end of the sink process() */
+struct LatencyStats {
+	uint64_t numSamples; //data with a known ingest time
+	uint64_t p50InUs, p99InUs, maxInUs; //with a precision of ~3% (see Histogram)
+	uint64_t totalInUs;
+};
+
+/* activity of a module since it was added. The times of a module include the ones of the modules fused with it. */
+struct ModuleStats {
+	std::string name;
+	uint64_t numPacketsIn, numPacketsOut;
+	uint64_t numBytesIn, numBytesOut;
+	uint64_t queueDepth, maxQueueDepth; //data received but not processed yet
+	uint64_t processTimeInUs;           //wall time spent in process()
+	uint64_t cpuTimeInUs;               //CPU time of the threads running process()
+	uint64_t queueWaitTimeInUs;         //cumulative time spent by the data in the queue before being processed
+	std::vector<LatencyStats> latencies; //sinks only: one per input
+};
+
+enum StatsFormat {
+	StatsJsonLines,  //one line appended per dump
+	StatsPrometheus, //text exposition format: the file is replaced on each dump
+};
+
 struct IPipelinedModule : public Modules::IModule {
 	virtual bool isSource() const = 0;
 	virtual bool isSink() const = 0;
 	virtual void connect(Modules::IOutput *output, size_t inputIdx) = 0;
+	/* runs in the thread of 'upstream' (i.e. data is passed by direct call) instead of its own executor */
+	virtual void fuse(IPipelinedModule *upstream) = 0;
+	virtual ModuleStats getStats() const = 0;
 };
 
 struct ICompletionNotifier {
@@ -24,29 +54,66 @@ struct ICompletionNotifier {
 
 class Pipeline : public ICompletionNotifier {
 	public:
-		Pipeline(bool isLowLatency = false);
+		/* 'policy' applies to the modules added without their own */
+		Pipeline(bool isLowLatency = false, const Modules::ExecutionPolicy &policy = Modules::ExecutionPolicy());
 
 		template <typename InstanceType, typename ...Args>
 		IPipelinedModule* addModule(Args&&... args) {
+			return addModuleWithPolicy<InstanceType>(defaultPolicy, std::forward<Args>(args)...);
+		}
+
+		/* e.g. gives the capture or the encoder a dedicated (pinned) thread or a separate pool */
+		template <typename InstanceType, typename ...Args>
+		IPipelinedModule* addModuleWithPolicy(const Modules::ExecutionPolicy &policy, Args&&... args) {
 			if (isLowLatency) {
-				return addModuleInternal(createModule<InstanceType>(Modules::ALLOC_NUM_BLOCKS_LOW_LATENCY, std::forward<Args>(args)...));
+				return addModuleInternal(createModule<InstanceType>(Modules::ALLOC_NUM_BLOCKS_LOW_LATENCY, std::forward<Args>(args)...), policy);
 			} else {
-				return addModuleInternal(createModule<InstanceType>(Modules::ALLOC_NUM_BLOCKS_DEFAULT, std::forward<Args>(args)...));
+				return addModuleInternal(createModule<InstanceType>(Modules::ALLOC_NUM_BLOCKS_DEFAULT, std::forward<Args>(args)...), policy);
 			}
 		}
 
 		void connect(Modules::IModule *prev, size_t outputIdx, Modules::IModule *next, size_t inputIdx);
 
+		/* hint: 'module' is called inline by its single upstream module. Applied on start(). */
+		void fuse(Modules::IModule *module);
+		/* on start(), fuses the modules whose single input is fed by a module with a single consumer */
+		void setAutoFusion(bool enable);
+
 		void start();
 		void waitForCompletion();
 		void exitSync(); /*ask for all sources to finish*/
 
+		/* logs the allocator stats of each output: helps sizing ALLOC_NUM_BLOCKS_* */
+		void dumpAllocatorStats() const;
+		/* dumps periodically while waiting for completion, and once completed. 0 disables. */
+		void setAllocatorStatsPeriod(std::chrono::milliseconds period);
+
+		/* one entry per module, in the order they were added */
+		std::vector<ModuleStats> getStats() const;
+		/* writes the module stats to 'path' periodically while waiting for completion, and once completed. 0 disables. */
+		void setStatsDump(const std::string &path, std::chrono::milliseconds period, StatsFormat format = StatsJsonLines);
+		void dumpStats() const;
+		/* logs the latencies measured by the sinks: called with each stats dump, and once completed */
+		void logLatencies() const;
+
 	private:
+		struct Connection {
+			Modules::IModule *prev, *next;
+		};
+
 		void finished() override;
-		IPipelinedModule* addModuleInternal(Modules::IModule *rawModule);
+		IPipelinedModule* addModuleInternal(Modules::IModule *rawModule, const Modules::ExecutionPolicy &policy);
+		void applyFusion();
 
 		std::vector<std::unique_ptr<IPipelinedModule>> modules;
-		bool isLowLatency;
+		std::vector<Connection> connections;
+		std::vector<Modules::IModule*> fusionHints;
+		bool isLowLatency, autoFusion;
+		Modules::ExecutionPolicy const defaultPolicy;
+		std::chrono::milliseconds allocatorStatsPeriod;
+		std::string statsPath;
+		std::chrono::milliseconds statsPeriod;
+		StatsFormat statsFormat;
 
 		std::mutex mutex;
 		std::condition_variable condition;
@@ -1,20 +1,82 @@
 #include "stranded_pool_executor.hpp"
+#include "lib_signals/utils/threadpool.hpp"
+#include <algorithm>
+#include <condition_variable>
 #include <functional>
 #include <future>
+#include <mutex>
 
 
 namespace Modules {
 
 //a shared thread pool for the modules
 #define N_THREADS_PER_CPU 2
-static asio::thread_pool g_threadPool { N_THREADS_PER_CPU * std::thread::hardware_concurrency() };
 
-StrandedPoolModuleExecutor::StrandedPoolModuleExecutor() : strand(g_threadPool.get_executor()) {
+asio::thread_pool& getDefaultThreadPool() {
+	static asio::thread_pool threadPool { N_THREADS_PER_CPU * std::thread::hardware_concurrency() };
+	return threadPool;
+}
+
+std::shared_ptr<asio::thread_pool> createThreadPool(unsigned numThreads, const std::vector<int> &cpuAffinity) {
+	if (!numThreads)
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	auto threadPool = std::make_shared<asio::thread_pool>(numThreads);
+	if (cpuAffinity.empty())
+		return threadPool;
+
+	//the pool doesn't expose its threads: each of them runs a task pinning it, then waits for all the others
+	struct Barrier {
+		std::mutex mutex;
+		std::condition_variable condition;
+		unsigned numPinned = 0;
+	};
+	auto barrier = std::make_shared<Barrier>(); //the last tasks may still be waking up when we return
+	for (unsigned i = 0; i < numThreads; ++i) {
+		asio::post(*threadPool, [barrier, cpuAffinity, numThreads]() {
+			std::unique_lock<std::mutex> lock(barrier->mutex);
+			auto const idx = barrier->numPinned++;
+			if (idx < cpuAffinity.size() && cpuAffinity[idx] >= 0)
+				Signals::setCurrentThreadAffinity(cpuAffinity[idx]);
+			barrier->condition.notify_all();
+			barrier->condition.wait(lock, [&] {
+				return barrier->numPinned == numThreads;
+			});
+		});
+	}
+	std::unique_lock<std::mutex> lock(barrier->mutex);
+	barrier->condition.wait(lock, [&] {
+		return barrier->numPinned == numThreads;
+	});
+	return threadPool;
+}
+
+std::unique_ptr<IProcessExecutor> createExecutor(const ExecutionPolicy &policy) {
+	switch (policy.mode) {
+	case ExecutionPolicy::StrandedPool:
+		if (policy.pool)
+			return std::unique_ptr<IProcessExecutor>(new StrandedPoolModuleExecutor(policy.pool));
+		return std::unique_ptr<IProcessExecutor>(new StrandedPoolModuleExecutor);
+	case ExecutionPolicy::DedicatedThread:
+		if (policy.cpu >= 0)
+			return std::unique_ptr<IProcessExecutor>(new Signals::ExecutorThread<void()>(policy.cpu));
+		return std::unique_ptr<IProcessExecutor>(new Signals::ExecutorThread<void()>);
+	case ExecutionPolicy::Synchronous:
+		return std::unique_ptr<IProcessExecutor>(new Signals::ExecutorSync<void()>);
+	default:
+		throw std::runtime_error("Unknown execution policy");
+	}
+}
+
+StrandedPoolModuleExecutor::StrandedPoolModuleExecutor() : strand(getDefaultThreadPool().get_executor()) {
 }
 
 StrandedPoolModuleExecutor::StrandedPoolModuleExecutor(asio::thread_pool &threadPool) : strand(threadPool.get_executor()) {
 }
 
+StrandedPoolModuleExecutor::StrandedPoolModuleExecutor(std::shared_ptr<asio::thread_pool> threadPool)
+	: threadPool(threadPool), strand(threadPool->get_executor()) {
+}
+
 std::shared_future<NotVoid<void>> StrandedPoolModuleExecutor::operator() (const std::function<void()> &fn) {
 	std::shared_future<NotVoid<void>> future = std::async(std::launch::deferred, [] { return NotVoid<void>(); });
 	auto closure = [future, fn]() -> void {
@@ -25,4 +87,8 @@ std::shared_future<NotVoid<void>> StrandedPoolModuleExecutor::operator() (const
 	return future;
 }
 
+void StrandedPoolModuleExecutor::post(Signals::InplaceFunction<void()> fn) {
+	asio::post(strand, std::move(fn));
+}
+
 }
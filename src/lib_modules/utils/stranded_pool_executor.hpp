@@ -3,6 +3,7 @@
 #define ASIO_STANDALONE
 #include <asio/asio.hpp>
 #include "../core/data.hpp"
+#include "execution_policy.hpp"
 #include "lib_signals/core/executor.hpp"
 #include <memory>
 
@@ -22,12 +23,21 @@ class StrandedPoolModuleExecutor : public IProcessExecutor {
 	public:
 		StrandedPoolModuleExecutor();
 		StrandedPoolModuleExecutor(asio::thread_pool &threadPool);
+		/* shares the ownership of the pool */
+		StrandedPoolModuleExecutor(std::shared_ptr<asio::thread_pool> threadPool);
 		std::shared_future<NotVoid<void>> operator() (const std::function<void()> &fn);
+		void post(Signals::InplaceFunction<void()> fn);
 
 	private:
+		std::shared_ptr<asio::thread_pool> const threadPool;
 		asio::strand<asio::thread_pool::executor_type> strand;
 };
 
+/* the pool shared by the modules: its threads are only created when it is first used */
+asio::thread_pool& getDefaultThreadPool();
+
+std::unique_ptr<IProcessExecutor> createExecutor(const ExecutionPolicy &policy);
+
 static Signals::ExecutorSync<void()> g_executorSync;
 //static StrandedPoolModuleExecutor g_StrandedExecutor;
 #define defaultExecutor g_executorSync
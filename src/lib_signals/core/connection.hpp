@@ -2,49 +2,165 @@
 
 #include <cassert>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace Signals {
 
+/**
+ * A connection is stored by value in a contiguous array: it only holds the executor,
+ * the callback and its handle. Pending futures (non-void results) are stored aside.
+ * The callback is shared so that asynchronous executors can hold it without copying it.
+ */
 template<typename ResultType, typename... Args>
 class ConnectionList {
 	public:
 		typedef NotVoid<ResultType> FutureResultType;
-		IExecutor<ResultType(Args...)> &executor;
-		std::function<ResultType(Args...)> const callback;
-		size_t const uid;
-		std::vector<std::shared_future<FutureResultType>> futures;
 
-		explicit ConnectionList(IExecutor<ResultType(Args...)> &executor, const std::function<ResultType(Args...)> &callback, const size_t uid) : executor(executor), callback(callback), uid(uid) {
+		explicit ConnectionList(IExecutor<ResultType(Args...)> &executor, const std::function<ResultType(Args...)> &callback, const size_t uid)
+			: executor(&executor), callback(std::make_shared<const std::function<ResultType(Args...)>>(callback)), uid(uid), pending(std::make_shared<PendingFutures>()) {
 		}
+
+		void dispatch(const Args&... args) const {
+			auto const f = (*executor)(*callback, args...);
+			std::lock_guard<std::mutex> lg(pending->mutex);
+			pending->futures.push_back(f);
+		}
+
+		/* results are needed for each item: no batching */
+		void dispatchBatch(span<const BatchItem<Args...>> batch) const {
+			for (auto &item : batch) {
+				Batch<Args...>::apply([this](Args... args) {
+					dispatch(args...);
+				}, item);
+			}
+		}
+
+		/* returns true when stopped after the first result (single mode) */
+		template<typename Result>
+		bool fillResults(Result &result, bool sync, bool single) const {
+			std::lock_guard<std::mutex> lg(pending->mutex);
+			auto &futures = pending->futures;
+			for (auto f = futures.begin(); f != futures.end();) {
+				if (!sync && (f->wait_for(std::chrono::nanoseconds(0)) != std::future_status::ready)) {
+					++f;
+				} else {
+					assert(f->valid());
+					result.set(f->get());
+					f = futures.erase(f);
+					if (single) {
+						return true;
+					}
+				}
+			}
+			return false;
+		}
+
+		IExecutor<ResultType(Args...)> *executor;
+		std::shared_ptr<const std::function<ResultType(Args...)>> callback;
+		size_t uid;
+
+	private:
+		struct PendingFutures {
+			std::mutex mutex;
+			std::vector<std::shared_future<FutureResultType>> futures;
+		};
+		std::shared_ptr<PendingFutures> pending;
 };
 
+//void results are never read: fire-and-forget, nothing to store, nothing to lock
 template<typename... Args>
 class ConnectionList<void, Args...> {
+	public:
+		explicit ConnectionList(IExecutor<void(Args...)> &executor, const std::function<void(Args...)> &callback, const size_t uid)
+			: executor(&executor), callback(std::make_shared<const std::function<void(Args...)>>(callback)), uid(uid) {
+		}
+
+		void dispatch(const Args&... args) const {
+			executor->postShared(callback, args...);
+		}
+
+		void dispatchBatch(span<const BatchItem<Args...>> batch) const {
+			executor->postBatch(makeSlot(), batch);
+		}
+
+		template<typename Result>
+		bool fillResults(Result&, bool, bool) const {
+			return false;
+		}
+
+		IExecutor<void(Args...)> *executor;
+		std::shared_ptr<const std::function<void(Args...)>> callback;
+		size_t uid;
+
 	private:
-		template<typename T>
-		class FakeVector {
-			public:
-				void push_back(T const&) {}
-				T* erase(T*) {
-					return nullptr;
-				}
-				T* begin() {
-					return nullptr;
-				}
-				T* end() {
-					return nullptr;
-				}
-		};
+		InplaceFunction<void(Args...)> makeSlot() const {
+			auto const cb = callback;
+			return [cb](Args... args) {
+				(*cb)(std::forward<Args>(args)...);
+			};
+		}
+};
 
+/**
+ * Generation-checked connection handles: the low bits index a slot which stores the
+ * position of the connection in the contiguous array. A slot generation is bumped on
+ * disconnection so that stale handles are rejected.
+ */
+class ConnectionSlots {
 	public:
-		IExecutor<void(Args...)> &executor;
-		std::function<void(Args...)> const callback;
-		size_t const uid;
-		FakeVector<std::shared_future<NotVoid<void>>> futures;
+		static const size_t InvalidPosition = (size_t)-1;
 
-		explicit ConnectionList(IExecutor<void(Args...)> &executor, const std::function<void(Args...)> &callback, const size_t uid) : executor(executor), callback(callback), uid(uid) {
+		size_t acquire(size_t position) {
+			size_t idx;
+			if (freeSlots.empty()) {
+				idx = slots.size();
+				slots.push_back(Slot());
+			} else {
+				idx = freeSlots.back();
+				freeSlots.pop_back();
+			}
+			slots[idx].position = position;
+			return makeHandle(idx, slots[idx].generation);
 		}
+
+		/* returns InvalidPosition for unknown or stale handles */
+		size_t getPosition(size_t handle) const {
+			auto const idx = handle & indexMask;
+			if (idx >= slots.size() || slots[idx].generation != (handle >> indexBits) || slots[idx].position == InvalidPosition)
+				return InvalidPosition;
+			return slots[idx].position;
+		}
+
+		void setPosition(size_t handle, size_t position) {
+			slots[handle & indexMask].position = position;
+		}
+
+		void release(size_t handle) {
+			auto const idx = handle & indexMask;
+			slots[idx].position = InvalidPosition;
+			slots[idx].generation = (slots[idx].generation + 1) & generationMask;
+			if (slots[idx].generation == 0)
+				slots[idx].generation = 1;
+			freeSlots.push_back(idx);
+		}
+
+	private:
+		static const size_t indexBits = sizeof(size_t) * 4;
+		static const size_t indexMask = ((size_t)1 << indexBits) - 1;
+		static const size_t generationMask = indexMask;
+
+		static size_t makeHandle(size_t idx, size_t generation) {
+			return (generation << indexBits) | idx;
+		}
+
+		struct Slot {
+			size_t generation = 1; //handle 0 is never valid
+			size_t position = InvalidPosition;
+		};
+		std::vector<Slot> slots;
+		std::vector<size_t> freeSlots;
 };
 
 }
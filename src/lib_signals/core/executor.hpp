@@ -1,9 +1,19 @@
 #pragma once
 
+#include "../utils/inplace_function.hpp"
 #include "../utils/threadpool.hpp"
 #include "lib_utils/tools.hpp"
+#include <algorithm>
+#include <condition_variable>
 #include <functional>
 #include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 
 namespace Signals {
@@ -23,18 +33,99 @@ std::function<int(Args...)> NotVoidFunction(std::function<void(Args...)> fn) {
 	return closure;
 }
 
+/* a batch item holds the arguments of one call: the argument itself for single-argument signatures, a tuple otherwise */
+template<typename... Args>
+struct Batch {
+	typedef std::tuple<typename std::decay<Args>::type...> Item;
+
+	template<typename Function>
+	static void apply(Function &&f, const Item &item) {
+		applyIndexed(f, item, std::index_sequence_for<Args...>());
+	}
+
+private:
+	template<typename Function, size_t... I>
+	static void applyIndexed(Function &f, const Item &item, std::index_sequence<I...>) {
+		f(std::get<I>(item)...);
+	}
+};
+
+template<typename Arg>
+struct Batch<Arg> {
+	typedef typename std::decay<Arg>::type Item;
+
+	template<typename Function>
+	static void apply(Function &&f, const Item &item) {
+		f(item);
+	}
+};
+
+template<typename... Args> using BatchItem = typename Batch<Args...>::Item;
+
+/* owns a copy of the arguments, which are moved to the function when called: used to cross threads */
+template<typename R, typename... Args>
+class DeferredCall {
+	public:
+		DeferredCall(InplaceFunction<R(Args...)> &&fn, const Args&... args) : fn(std::move(fn)), args(args...) {
+		}
+
+		void operator()() {
+			call(std::index_sequence_for<Args...>());
+		}
+
+	private:
+		template<size_t... I>
+		void call(std::index_sequence<I...>) {
+			fn(std::forward<Args>(std::get<I>(args))...);
+		}
+
+		InplaceFunction<R(Args...)> fn;
+		std::tuple<typename std::decay<Args>::type...> args; //references are copied too: the caller's objects may be gone
+};
+
 template<typename> class IExecutor;
 
 template <typename R, typename... Args>
 class IExecutor<R(Args...)> {
 	public:
 		virtual ~IExecutor() noexcept(false) {}
-		virtual std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, Args... args) = 0;
+		virtual std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) = 0;
+
+		/**
+		* Fire-and-forget: the result is dropped. Executors which override it dispatch without creating
+		* any future or shared state, and without allocating.
+		*/
+		virtual void post(InplaceFunction<R(Args...)> fn, const Args&... args) {
+			auto const f = std::make_shared<InplaceFunction<R(Args...)>>(std::move(fn));
+			(*this)([f](Args... a) {
+				return (*f)(std::forward<Args>(a)...);
+			}, args...);
+		}
+
+		/* fire-and-forget on a callback owned by the caller: only executors which defer the call need to share its ownership */
+		virtual void postShared(const std::shared_ptr<const std::function<R(Args...)>> &fn, const Args&... args) {
+			post([fn](Args... a) {
+				return (*fn)(std::forward<Args>(a)...);
+			}, args...);
+		}
+
+		/* fire-and-forget on each item of the batch. Asynchronous executors may dispatch the whole batch as a single task. */
+		virtual void postBatch(InplaceFunction<R(Args...)> fn, span<const BatchItem<Args...>> batch) {
+			auto const f = std::make_shared<InplaceFunction<R(Args...)>>(std::move(fn));
+			for (auto &item : batch) {
+				Batch<Args...>::apply([&](Args... args) {
+					post([f](Args... a) {
+						return (*f)(std::forward<Args>(a)...);
+					}, args...);
+				}, item);
+			}
+		}
 };
 
 template<typename> class ExecutorSync;
 template<typename> class ExecutorLazy;
 template<typename> class ExecutorAsync;
+template<typename> class ExecutorBounded;
 template<typename> class ExecutorAuto;
 template<typename> class ExecutorThread;
 template<typename> class ExecutorThreadPool;
@@ -43,19 +134,33 @@ template<typename> class ExecutorThreadPool;
 template<typename R, typename... Args>
 class ExecutorSync<R(Args...)> : public IExecutor<R(Args...)> {
 	public:
-		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, Args... args) {
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
 			std::packaged_task<NotVoid<R>(Args...)> task(NotVoidFunction(fn));
 			const std::shared_future<NotVoid<R>> &f = task.get_future();
 			task(args...);
 			return f;
 		}
+
+		void post(InplaceFunction<R(Args...)> fn, const Args&... args) {
+			fn(args...);
+		}
+
+		void postShared(const std::shared_ptr<const std::function<R(Args...)>> &fn, const Args&... args) {
+			(*fn)(args...);
+		}
+
+		void postBatch(InplaceFunction<R(Args...)> fn, span<const BatchItem<Args...>> batch) {
+			for (auto &item : batch) {
+				Batch<Args...>::apply(fn, item);
+			}
+		}
 };
 
 //synchronous lazy calls
 template<typename R, typename... Args>
 class ExecutorLazy<R(Args...)> : public IExecutor<R(Args...)> {
 	public:
-		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, Args... args) {
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
 			return std::async(std::launch::deferred, NotVoidFunction(fn), args...);
 		}
 };
@@ -64,16 +169,148 @@ class ExecutorLazy<R(Args...)> : public IExecutor<R(Args...)> {
 template<typename R, typename... Args>
 class ExecutorAsync<R(Args...)> : public IExecutor<R(Args...)> {
 	public:
-		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, Args... args) {
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
 			return std::async(std::launch::async, NotVoidFunction(fn), args...);
 		}
 };
 
+/* workers shared by all the bounded executors, created on first use */
+inline std::shared_ptr<ThreadPool> getSharedThreadPool() {
+	static auto pool = std::make_shared<ThreadPool>(std::max(4u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+/**
+ * Asynchronous calls on the shared worker set: at most maxConcurrency tasks of this executor run at the same
+ * time and at most maxQueued wait for a worker (emitting blocks beyond). Emitting from a worker of the pool
+ * (e.g. from a slot) never blocks, because that worker may be needed to drain the queue: the limit is exceeded
+ * instead. Destroying the executor waits for its pending tasks. When one of its own tasks destroys it, the
+ * pending tasks are run by the destructor and the running ones of the other workers are waited for.
+ */
+template<typename R, typename... Args>
+class ExecutorBounded<R(Args...)> : public IExecutor<R(Args...)> {
+	public:
+		ExecutorBounded(size_t maxConcurrency = 0, size_t maxQueued = 1024, std::shared_ptr<ThreadPool> pool = getSharedThreadPool())
+			: pool(pool), maxConcurrency(maxConcurrency ? maxConcurrency : pool->getNumWorkers()), maxQueued(maxQueued) {
+			if (maxQueued == 0)
+				throw std::runtime_error("ExecutorBounded queue limit cannot be 0.");
+		}
+
+		~ExecutorBounded() noexcept(false) {
+			std::unique_lock<std::mutex> lock(mutex);
+			auto &current = currentDrain();
+			if (current == this) {
+				//called from one of our tasks: its drain() can't complete, and won't touch this executor again
+				while (!tasks.empty()) {
+					auto task = tasks.pop_front();
+					lock.unlock();
+					task();
+					lock.lock();
+				}
+				current = nullptr;
+				idle.wait(lock, [&] {
+					return numRunning == 1;
+				});
+				return;
+			}
+			idle.wait(lock, [&] {
+				return numRunning == 0;
+			});
+		}
+
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
+			auto task = std::make_shared<std::packaged_task<NotVoid<R>()>>(std::bind(NotVoidFunction(fn), args...));
+			const std::shared_future<NotVoid<R>> future = task->get_future();
+			enqueue([task]() {
+				(*task)();
+			});
+			return future;
+		}
+
+		void post(InplaceFunction<R(Args...)> fn, const Args&... args) {
+			enqueue(DeferredCall<R, Args...>(std::move(fn), args...));
+		}
+
+		/* the batch is copied and executed as one task */
+		void postBatch(InplaceFunction<R(Args...)> fn, span<const BatchItem<Args...>> batch) {
+			auto const items = std::make_shared<std::vector<BatchItem<Args...>>>(batch.begin(), batch.end());
+			enqueue([fn = std::move(fn), items]() {
+				for (auto &item : *items) {
+					Batch<Args...>::apply(fn, item);
+				}
+			});
+		}
+
+	private:
+		ExecutorBounded(const ExecutorBounded&) = delete;
+		ExecutorBounded& operator= (const ExecutorBounded&) = delete;
+
+		void enqueue(ThreadPool::Task task) {
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!pool->isCurrentThreadWorker()) {
+				notFull.wait(lock, [&] {
+					return tasks.size() < maxQueued;
+				});
+			}
+			tasks.push_back(std::move(task));
+			if (numRunning < maxConcurrency) {
+				numRunning++;
+				lock.unlock();
+				pool->post([this]() {
+					drain();
+				});
+			}
+		}
+
+		/* runs a bounded number of tasks, then yields the worker back to the pool */
+		void drain() {
+			const int maxTasksPerDrain = 64;
+			std::unique_lock<std::mutex> lock(mutex);
+			for (int i = 0; i < maxTasksPerDrain && !tasks.empty(); ++i) {
+				auto task = tasks.pop_front();
+				notFull.notify_all();
+				lock.unlock();
+				auto &current = currentDrain();
+				auto const prev = current;
+				current = this;
+				task();
+				auto const destroyed = !current;
+				current = prev;
+				if (destroyed)
+					return; //by the task
+				lock.lock();
+			}
+			if (!tasks.empty()) {
+				lock.unlock();
+				pool->post([this]() {
+					drain();
+				});
+				return;
+			}
+			numRunning--;
+			if (numRunning <= 1) //1: the destructor may run in the remaining drain()
+				idle.notify_all();
+		}
+
+		/* the executor whose drain() runs a task on the current thread */
+		static ExecutorBounded*& currentDrain() {
+			static thread_local ExecutorBounded *current = nullptr;
+			return current;
+		}
+
+		std::shared_ptr<ThreadPool> const pool;
+		size_t const maxConcurrency, maxQueued;
+		std::mutex mutex;
+		std::condition_variable notFull, idle;
+		RingDeque<ThreadPool::Task> tasks; //protected by mutex
+		size_t numRunning = 0;              //protected by mutex
+};
+
 //asynchronous or synchronous calls at the runtime convenience
 template<typename R, typename... Args>
 class ExecutorAuto<R(Args...)> : public IExecutor<R(Args...)> {
 	public:
-		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, Args... args) {
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
 			return std::async(std::launch::async | std::launch::deferred, NotVoidFunction(fn), args...);
 		}
 };
@@ -85,10 +322,27 @@ class ExecutorThread<R(Args...)> : public IExecutor<R(Args...)> {
 		ExecutorThread() : threadPool(1) {
 		}
 
-		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, Args... args) {
+		/* pins the thread to the given CPU */
+		explicit ExecutorThread(int cpu) : threadPool(1, std::vector<int>(1, cpu)) {
+		}
+
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
 			return threadPool.submit(NotVoidFunction(fn), args...);
 		}
 
+		void post(InplaceFunction<R(Args...)> fn, const Args&... args) {
+			threadPool.post(DeferredCall<R, Args...>(std::move(fn), args...));
+		}
+
+		void postBatch(InplaceFunction<R(Args...)> fn, span<const BatchItem<Args...>> batch) {
+			auto const items = std::make_shared<std::vector<BatchItem<Args...>>>(batch.begin(), batch.end());
+			threadPool.post([fn = std::move(fn), items]() {
+				for (auto &item : *items) {
+					Batch<Args...>::apply(fn, item);
+				}
+			});
+		}
+
 	private:
 		ThreadPool threadPool;
 };
@@ -103,10 +357,23 @@ class ExecutorThreadPool<R(Args...)> : public IExecutor<R(Args...)> {
 		ExecutorThreadPool(std::shared_ptr<ThreadPool> threadPool) : threadPool(threadPool) {
 		}
 
-		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, Args... args) {
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
 			return threadPool->submit(NotVoidFunction(fn), args...);
 		}
 
+		void post(InplaceFunction<R(Args...)> fn, const Args&... args) {
+			threadPool->post(DeferredCall<R, Args...>(std::move(fn), args...));
+		}
+
+		void postBatch(InplaceFunction<R(Args...)> fn, span<const BatchItem<Args...>> batch) {
+			auto const items = std::make_shared<std::vector<BatchItem<Args...>>>(batch.begin(), batch.end());
+			threadPool->post([fn = std::move(fn), items]() {
+				for (auto &item : *items) {
+					Batch<Args...>::apply(fn, item);
+				}
+			});
+		}
+
 	private:
 		std::shared_ptr<ThreadPool> threadPool;
 };
@@ -4,11 +4,13 @@
 #include "connection.hpp"
 #include "result.hpp"
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <functional>
-#include <map>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 
 namespace Signals {
@@ -21,7 +23,11 @@ class ISignal<Callback(Args...)> {
 		virtual size_t connect(const std::function<Callback(Args...)> &cb, IExecutor<Callback(Args...)> &executor) = 0;
 		virtual size_t connect(const std::function<Callback(Args...)> &cb) = 0;
 		virtual bool disconnect(size_t connectionId) = 0;
-		virtual size_t emit(Args... args) = 0;
+		/* arguments are passed by reference down to synchronous callbacks: they are only copied when crossing threads */
+		virtual size_t emit(const Args&... args) = 0;
+
+		/* each connection receives all the items in order; asynchronous executors may run them as a single task */
+		virtual size_t emitBatch(span<const BatchItem<Args...>> batch) = 0;
 
 		virtual IExecutor<Callback(Args...)>& getExecutor() const = 0;
 
@@ -47,13 +53,16 @@ class PSignal<Result, Callback(Args...)> : public ISignal<Callback(Args...)> {
 		typedef typename Result::ResultValue ResultValue;
 		typedef typename CallbackType::result_type ResultType;
 		typedef ConnectionList<ResultType, Args...> ConnectionType;
-		typedef std::map<size_t, ConnectionType*> ConnectionManager;
+		/*contiguous, immutable once published: connect() and disconnect() publish a modified copy (copy-on-write)*/
+		typedef std::vector<ConnectionType> ConnectionManager;
 
 	public:
 		size_t connect(const CallbackType &cb, IExecutor<Callback(Args...)> &executor) {
 			std::lock_guard<std::mutex> lg(callbacksMutex);
-			const size_t connectionId = uid++;
-			callbacks[connectionId] = new ConnectionType(executor, cb, connectionId);
+			auto newCallbacks = std::make_shared<ConnectionManager>(*std::atomic_load(&callbacks));
+			const size_t connectionId = slots.acquire(newCallbacks->size());
+			newCallbacks->push_back(ConnectionType(executor, cb, connectionId));
+			std::atomic_store(&callbacks, std::shared_ptr<const ConnectionManager>(newCallbacks));
 			return connectionId;
 		}
 
@@ -66,13 +75,23 @@ class PSignal<Result, Callback(Args...)> : public ISignal<Callback(Args...)> {
 			return disconnectUnsafe(connectionId);
 		}
 
-		size_t emit(Args... args) {
-			std::lock_guard<std::mutex> lg(callbacksMutex);
-			result.clear();
-			for (auto &cb : callbacks) {
-				cb.second->futures.push_back(cb.second->executor(cb.second->callback, args...));
+		/* lock-free: walks the snapshot of the connections current at call time */
+		size_t emit(const Args&... args) {
+			auto const snapshot = std::atomic_load(&callbacks);
+			emitCount++;
+			for (auto &cb : *snapshot) {
+				cb.dispatch(args...);
+			}
+			return snapshot->size();
+		}
+
+		size_t emitBatch(span<const BatchItem<Args...>> batch) {
+			auto const snapshot = std::atomic_load(&callbacks);
+			emitCount++;
+			for (auto &cb : *snapshot) {
+				cb.dispatchBatch(batch);
 			}
-			return callbacks.size();
+			return snapshot->size();
 		}
 
 		void flushAvailableResults() {
@@ -91,54 +110,58 @@ class PSignal<Result, Callback(Args...)> : public ISignal<Callback(Args...)> {
 		}
 
 	protected:
-		PSignal() : defaultExecutor(new ExecutorAsync<Callback(Args...)>()), executor(*defaultExecutor.get()) {
+		PSignal() : callbacks(std::make_shared<const ConnectionManager>()), defaultExecutor(new ExecutorBounded<Callback(Args...)>()), executor(*defaultExecutor.get()) {
 		}
 
-		PSignal(IExecutor<Callback(Args...)> &executor) : executor(executor) {
+		PSignal(IExecutor<Callback(Args...)> &executor) : callbacks(std::make_shared<const ConnectionManager>()), executor(executor) {
 		}
 
 		virtual ~PSignal() {
-			while (!callbacks.empty()) { //delete still connected callbacks
-				auto& cb = *callbacks.begin();
-				bool res = disconnectUnsafe(cb.first);
-				assert(res);
-			}
+			std::lock_guard<std::mutex> lg(callbacksMutex);
+			std::atomic_store(&callbacks, std::make_shared<const ConnectionManager>()); //delete still connected callbacks
 		}
 
 	private:
 		PSignal(const PSignal&) = delete;
 		PSignal& operator= (const PSignal&) = delete;
 
+		/* swap-remove: the emission order of the remaining connections is not preserved */
 		bool disconnectUnsafe(size_t connectionId) {
-			auto conn = callbacks.find(connectionId);
-			if (conn == callbacks.end())
+			auto const pos = slots.getPosition(connectionId);
+			if (pos == ConnectionSlots::InvalidPosition)
 				return false;
-			delete conn->second;
-			callbacks.erase(connectionId);
+			auto newCallbacks = std::make_shared<ConnectionManager>(*std::atomic_load(&callbacks));
+			assert(pos < newCallbacks->size() && (*newCallbacks)[pos].uid == connectionId);
+			if (pos + 1 != newCallbacks->size()) {
+				std::swap((*newCallbacks)[pos], newCallbacks->back());
+				slots.setPosition((*newCallbacks)[pos].uid, pos);
+			}
+			newCallbacks->pop_back();
+			slots.release(connectionId);
+			std::atomic_store(&callbacks, std::shared_ptr<const ConnectionManager>(newCallbacks));
 			return true;
 		}
 
+		/*results only cover the emit() calls since the last harvest*/
 		void fillResultsUnsafe(bool sync = true, bool single = false) {
-			for (auto &cb : callbacks) {
-				for (auto f = cb.second->futures.begin(); f != cb.second->futures.end();) {
-					if (!sync && (f->wait_for(std::chrono::nanoseconds(0)) != std::future_status::ready)) {
-						++f;
-					} else {
-						assert(f->valid());
-						result.set(f->get());
-						f = cb.second->futures.erase(f);
-						if (single) {
-							return;
-						}
-					}
-				}
+			auto const currentEmitCount = emitCount.load();
+			if (currentEmitCount != lastEmitCount) {
+				result.clear();
+				lastEmitCount = currentEmitCount;
+			}
+			auto const snapshot = std::atomic_load(&callbacks);
+			for (auto &cb : *snapshot) {
+				if (cb.fillResults(result, sync, single))
+					return;
 			}
 		}
 
-		std::mutex callbacksMutex;
-		ConnectionManager callbacks; //protected by callbacksMutex
+		std::mutex callbacksMutex;                           //serializes writers and results
+		std::shared_ptr<const ConnectionManager> callbacks;  //atomic access only (std::atomic_load/std::atomic_store)
+		std::atomic<uint64_t> emitCount {0};
+		uint64_t lastEmitCount = 0;  //protected by callbacksMutex
 		Result result;               //protected by callbacksMutex
-		size_t uid = 0;              //protected by callbacksMutex
+		ConnectionSlots slots;       //protected by callbacksMutex
 
 		std::unique_ptr<IExecutor<Callback(Args...)>> const defaultExecutor;
 		IExecutor<Callback(Args...)> &executor;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+
+
+namespace Signals {
+
+/**
+ * Signal whose connections are fixed at compile time: the slots are stored by value and called directly
+ * (no std::function, no executor, no virtual call) so that the compiler can inline them.
+ * Slots are called synchronously, in connection order, and their results are dropped.
+ */
+template<typename... Slots>
+class StaticSignal {
+	public:
+		explicit StaticSignal(Slots... slots) : slots(std::move(slots)...) {
+		}
+
+		template<typename... Args>
+		size_t emit(const Args&... args) {
+			emitAll(std::index_sequence_for<Slots...>(), args...);
+			return sizeof...(Slots);
+		}
+
+		/* connections are part of the type: returns a new signal with the slot appended */
+		template<typename Slot>
+		StaticSignal<Slots..., Slot> connect(Slot slot) const {
+			return connectAll(std::index_sequence_for<Slots...>(), std::move(slot));
+		}
+
+		template<size_t I>
+		typename std::tuple_element<I, std::tuple<Slots...>>::type& getSlot() {
+			return std::get<I>(slots);
+		}
+
+	private:
+		template<typename...> friend class StaticSignal;
+
+		template<size_t... I, typename... Args>
+		void emitAll(std::index_sequence<I...>, const Args&... args) {
+			int unused[] = { 0, (std::get<I>(slots)(args...), 0)... };
+			(void)unused;
+		}
+
+		template<size_t... I, typename Slot>
+		StaticSignal<Slots..., Slot> connectAll(std::index_sequence<I...>, Slot slot) const {
+			return StaticSignal<Slots..., Slot>(std::get<I>(slots)..., std::move(slot));
+		}
+
+		std::tuple<Slots...> slots;
+};
+
+template<typename... Slots>
+StaticSignal<Slots...> makeStaticSignal(Slots... slots) {
+	return StaticSignal<Slots...>(std::move(slots)...);
+}
+
+/* slot forwarding to a dynamic signal: mixes connections fixed at compile time with runtime ones */
+template<typename SignalType>
+class SignalSlot {
+	public:
+		explicit SignalSlot(SignalType &signal) : signal(&signal) {
+		}
+
+		template<typename... Args>
+		void operator()(const Args&... args) const {
+			signal->emit(args...);
+		}
+
+	private:
+		SignalType *signal;
+};
+
+template<typename SignalType>
+SignalSlot<SignalType> makeSignalSlot(SignalType &signal) {
+	return SignalSlot<SignalType>(signal);
+}
+
+}
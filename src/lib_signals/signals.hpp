@@ -1,6 +1,9 @@
 #pragma once
 
 #include "utils/helper.hpp"
+#include "utils/inplace_function.hpp"
+#include "utils/queue_lock_free.hpp"
 #include "utils/threadpool.hpp"
 #include "core/signal.hpp"
+#include "core/static_signal.hpp"
 
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+namespace Signals {
+
+static const size_t InplaceFunctionDefaultCapacity = 32;
+
+template<typename Signature, size_t Capacity = InplaceFunctionDefaultCapacity> class InplaceFunction;
+
+/**
+ * Move-only callable stored in a fixed-capacity inline buffer: it never allocates.
+ * A callable which doesn't fit is a compile-time error.
+ */
+template<typename R, typename... Args, size_t Capacity>
+class InplaceFunction<R(Args...), Capacity> {
+	public:
+		InplaceFunction() : ops(nullptr) {}
+		InplaceFunction(std::nullptr_t) : ops(nullptr) {}
+
+		template<typename Callable, typename = typename std::enable_if<!std::is_same<typename std::decay<Callable>::type, InplaceFunction>::value>::type>
+		InplaceFunction(Callable &&callable) : ops(Ops<typename std::decay<Callable>::type>::get()) {
+			typedef typename std::decay<Callable>::type Target;
+			static_assert(sizeof(Target) <= Capacity, "InplaceFunction: the callable (i.e. its captures) doesn't fit in the capacity.");
+			static_assert(alignof(Target) <= alignof(Storage), "InplaceFunction: the callable alignment is not supported.");
+			new (&storage) Target(std::forward<Callable>(callable));
+		}
+
+		InplaceFunction(InplaceFunction &&other) : ops(other.ops) {
+			if (ops) {
+				ops->moveAndDestroy(&storage, &other.storage);
+				other.ops = nullptr;
+			}
+		}
+
+		InplaceFunction& operator= (InplaceFunction &&other) {
+			if (this != &other) {
+				reset();
+				if (other.ops) {
+					other.ops->moveAndDestroy(&storage, &other.storage);
+					ops = other.ops;
+					other.ops = nullptr;
+				}
+			}
+			return *this;
+		}
+
+		InplaceFunction& operator= (std::nullptr_t) {
+			reset();
+			return *this;
+		}
+
+		~InplaceFunction() {
+			reset();
+		}
+
+		R operator()(Args... args) const {
+			if (!ops)
+				throw std::bad_function_call();
+			return ops->invoke(const_cast<Storage*>(&storage), std::forward<Args>(args)...);
+		}
+
+		explicit operator bool() const {
+			return ops != nullptr;
+		}
+
+	private:
+		InplaceFunction(const InplaceFunction&) = delete;
+		InplaceFunction& operator= (const InplaceFunction&) = delete;
+
+		typedef typename std::aligned_storage<Capacity, alignof(std::max_align_t)>::type Storage;
+
+		struct VTable {
+			R (*invoke)(void *target, Args&&... args);
+			void (*moveAndDestroy)(void *dst, void *src);
+			void (*destroy)(void *target);
+		};
+
+		template<typename Target>
+		struct Ops {
+			static R invoke(void *target, Args&&... args) {
+				return (*static_cast<Target*>(target))(std::forward<Args>(args)...);
+			}
+			static void moveAndDestroy(void *dst, void *src) {
+				new (dst) Target(std::move(*static_cast<Target*>(src)));
+				static_cast<Target*>(src)->~Target();
+			}
+			static void destroy(void *target) {
+				static_cast<Target*>(target)->~Target();
+			}
+			static const VTable* get() {
+				static const VTable table = { &invoke, &moveAndDestroy, &destroy };
+				return &table;
+			}
+		};
+
+		void reset() {
+			if (ops) {
+				ops->destroy(&storage);
+				ops = nullptr;
+			}
+		}
+
+		Storage storage;
+		const VTable *ops;
+};
+
+}
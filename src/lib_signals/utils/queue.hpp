@@ -3,21 +3,50 @@
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <limits>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 
 namespace Signals {
 
 template<typename T>
-class Queue {
+class IQueue {
+	public:
+		virtual ~IQueue() noexcept(false) {}
+		virtual void push(T data) = 0;
+		virtual bool tryPop(T &value) = 0;
+		virtual T pop() = 0;
+		virtual void clear() = 0;
+
+		/* non-blocking: appends at most maxItems items to 'values'. Returns the number of items popped. */
+		virtual size_t tryPopN(std::vector<T> &values, size_t maxItems) {
+			size_t n = 0;
+			T value;
+			while (n < maxItems && tryPop(value)) {
+				values.push_back(std::move(value));
+				n++;
+			}
+			return n;
+		}
+
+		/* waits for at least one item, then appends all the available items to 'values'. Returns the number of items popped. */
+		virtual size_t popAll(std::vector<T> &values) {
+			values.push_back(pop());
+			return 1 + tryPopN(values, std::numeric_limits<size_t>::max());
+		}
+};
+
+template<typename T>
+class Queue : public IQueue<T> {
 	public:
 		Queue() {}
 		virtual ~Queue() noexcept(false) {}
 
 		virtual void push(T data) {
 			std::lock_guard<std::mutex> lock(mutex);
-			pushUnsafe(data);
+			pushUnsafe(std::move(data));
 		}
 
 		virtual bool tryPop(T &value) {
@@ -46,6 +75,20 @@ class Queue {
 			std::swap(emptyQueue, dataQueue);
 		}
 
+		/* single lock acquisition */
+		virtual size_t tryPopN(std::vector<T> &values, size_t maxItems) {
+			std::lock_guard<std::mutex> lock(mutex);
+			return popNUnsafe(values, maxItems);
+		}
+
+		/* single lock acquisition */
+		virtual size_t popAll(std::vector<T> &values) {
+			std::unique_lock<std::mutex> lock(mutex);
+			while (dataQueue.empty())
+				dataAvailable.wait(lock);
+			return popNUnsafe(values, std::numeric_limits<size_t>::max());
+		}
+
 #ifdef TESTS
 		size_t size() const {
 			std::lock_guard<std::mutex> lock(mutex);
@@ -84,6 +127,16 @@ class Queue {
 			dataAvailable.notify_one();
 		}
 
+		size_t popNUnsafe(std::vector<T> &values, size_t maxItems) {
+			size_t n = 0;
+			while (n < maxItems && !dataQueue.empty()) {
+				values.push_back(std::move(dataQueue.front()));
+				dataQueue.pop();
+				n++;
+			}
+			return n;
+		}
+
 		mutable std::mutex mutex;
 		std::queue<T> dataQueue;
 		std::condition_variable dataAvailable;
@@ -118,7 +171,7 @@ class QueueMaxSize : public Queue<T> {
 			dataWaitingToBePushed++;
 			while (Queue<T>::dataQueue.size() > maxSize)
 				dataPopped.wait(lock);
-			Queue<T>::pushUnsafe(data);
+			Queue<T>::pushUnsafe(std::move(data));
 			dataWaitingToBePushed--;
 		}
 
@@ -128,6 +181,18 @@ class QueueMaxSize : public Queue<T> {
 			return p;
 		}
 
+		size_t tryPopN(std::vector<T> &values, size_t maxItems) {
+			auto const n = Queue<T>::tryPopN(values, maxItems);
+			dataPopped.notify_all();
+			return n;
+		}
+
+		size_t popAll(std::vector<T> &values) {
+			auto const n = Queue<T>::popAll(values);
+			dataPopped.notify_all();
+			return n;
+		}
+
 		/* After a clear() call, you are guaranteed that all blocking push() will
 		   awaken and that the queue is empty. */
 		virtual void clear() {
@@ -0,0 +1,279 @@
+#pragma once
+
+#include "queue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+
+namespace Signals {
+
+/**
+ * Waits for a condition by spinning first, then parks the thread on a condition variable.
+ * The notifier only takes the lock when somebody is actually parked.
+ */
+class SpinThenPark {
+	public:
+		SpinThenPark(unsigned spinCount = 256) : spinCount(spinCount), numParked(0) {}
+
+		template<typename Predicate>
+		void wait(Predicate ready) {
+			for (unsigned i = 0; i < spinCount; ++i) {
+				if (ready())
+					return;
+				if (i >= spinCount / 2)
+					std::this_thread::yield();
+			}
+			std::unique_lock<std::mutex> lock(mutex);
+			numParked.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			while (!ready())
+				condition.wait(lock);
+			numParked.fetch_sub(1);
+		}
+
+		void notify() {
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (numParked.load(std::memory_order_relaxed) > 0) {
+				std::lock_guard<std::mutex> lock(mutex);
+				condition.notify_all();
+			}
+		}
+
+	private:
+		SpinThenPark(const SpinThenPark&) = delete;
+		SpinThenPark& operator= (const SpinThenPark&) = delete;
+
+		unsigned const spinCount;
+		std::atomic<unsigned> numParked;
+		std::mutex mutex;
+		std::condition_variable condition;
+};
+
+inline size_t roundUpToPow2(size_t n) {
+	size_t r = 2;
+	while (r < n)
+		r <<= 1;
+	return r;
+}
+
+/**
+ * Bounded lock-free queue for exactly one producer thread and one consumer thread.
+ * push() blocks when the queue is full. clear() must be called from the consumer side.
+ */
+template<typename T>
+class QueueSPSC : public IQueue<T> {
+	public:
+		explicit QueueSPSC(size_t capacity) : buffer(roundUpToPow2(capacity)), mask(buffer.size() - 1), writeIdx(0), readIdx(0) {
+			if (capacity == 0)
+				throw std::runtime_error("QueueSPSC capacity cannot be 0.");
+		}
+		virtual ~QueueSPSC() noexcept(false) {}
+
+		bool tryPush(T data) {
+			return tryPushRef(data);
+		}
+
+		void push(T data) override {
+			while (!tryPushRef(data)) {
+				notFull.wait([&] { return writeIdx.load(std::memory_order_relaxed) - readIdx.load(std::memory_order_acquire) < buffer.size(); });
+			}
+		}
+
+		bool tryPop(T &value) override {
+			auto const r = readIdx.load(std::memory_order_relaxed);
+			if (r == writeIdxCache) {
+				writeIdxCache = writeIdx.load(std::memory_order_acquire);
+				if (r == writeIdxCache)
+					return false;
+			}
+			value = std::move(buffer[r & mask]);
+			buffer[r & mask] = T();
+			readIdx.store(r + 1, std::memory_order_release);
+			notFull.notify();
+			return true;
+		}
+
+		T pop() override {
+			T value;
+			while (!tryPop(value)) {
+				notEmpty.wait([&] { return writeIdx.load(std::memory_order_acquire) != readIdx.load(std::memory_order_relaxed); });
+			}
+			return value;
+		}
+
+		void clear() override {
+			T value;
+			while (tryPop(value)) {
+			}
+		}
+
+	private:
+		QueueSPSC(const QueueSPSC&) = delete;
+		QueueSPSC& operator= (const QueueSPSC&) = delete;
+
+		bool tryPushRef(T &data) {
+			auto const w = writeIdx.load(std::memory_order_relaxed);
+			if (w - readIdxCache == buffer.size()) {
+				readIdxCache = readIdx.load(std::memory_order_acquire);
+				if (w - readIdxCache == buffer.size())
+					return false;
+			}
+			buffer[w & mask] = std::move(data);
+			writeIdx.store(w + 1, std::memory_order_release);
+			notEmpty.notify();
+			return true;
+		}
+
+		std::vector<T> buffer;
+		size_t const mask;
+
+		//producer and consumer indices live on separate cache lines
+		std::atomic<size_t> writeIdx;
+		size_t readIdxCache = 0; //producer only
+		char padding0[64];
+		std::atomic<size_t> readIdx;
+		size_t writeIdxCache = 0; //consumer only
+		char padding1[64];
+
+		SpinThenPark notEmpty, notFull;
+};
+
+/**
+ * Bounded lock-free queue for any number of producers and consumers (D. Vyukov's algorithm).
+ * push() blocks when the queue is full.
+ */
+template<typename T>
+class QueueMPMC : public IQueue<T> {
+	public:
+		explicit QueueMPMC(size_t capacity) : cells(roundUpToPow2(capacity)), mask(cells.size() - 1), enqueuePos(0), dequeuePos(0) {
+			if (capacity == 0)
+				throw std::runtime_error("QueueMPMC capacity cannot be 0.");
+			for (size_t i = 0; i < cells.size(); ++i) {
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+		virtual ~QueueMPMC() noexcept(false) {}
+
+		bool tryPush(T data) {
+			return tryPushRef(data);
+		}
+
+		void push(T data) override {
+			while (!tryPushRef(data)) {
+				notFull.wait([&] { return !isFull(); });
+			}
+		}
+
+		bool tryPop(T &value) override {
+			Cell *cell;
+			auto pos = dequeuePos.load(std::memory_order_relaxed);
+			for (;;) {
+				cell = &cells[pos & mask];
+				auto const seq = cell->sequence.load(std::memory_order_acquire);
+				auto const diff = (intptr_t)seq - (intptr_t)(pos + 1);
+				if (diff == 0) {
+					if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = dequeuePos.load(std::memory_order_relaxed);
+				}
+			}
+			value = std::move(cell->data);
+			cell->data = T();
+			cell->sequence.store(pos + mask + 1, std::memory_order_release);
+			notFull.notify();
+			return true;
+		}
+
+		T pop() override {
+			T value;
+			while (!tryPop(value)) {
+				notEmpty.wait([&] { return !isEmpty(); });
+			}
+			return value;
+		}
+
+		void clear() override {
+			T value;
+			while (tryPop(value)) {
+			}
+		}
+
+	private:
+		QueueMPMC(const QueueMPMC&) = delete;
+		QueueMPMC& operator= (const QueueMPMC&) = delete;
+
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T data;
+		};
+
+		bool tryPushRef(T &data) {
+			Cell *cell;
+			auto pos = enqueuePos.load(std::memory_order_relaxed);
+			for (;;) {
+				cell = &cells[pos & mask];
+				auto const seq = cell->sequence.load(std::memory_order_acquire);
+				auto const diff = (intptr_t)seq - (intptr_t)pos;
+				if (diff == 0) {
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				} else if (diff < 0) {
+					return false;
+				} else {
+					pos = enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+			cell->data = std::move(data);
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			notEmpty.notify();
+			return true;
+		}
+
+		bool isEmpty() const {
+			auto const pos = dequeuePos.load(std::memory_order_relaxed);
+			return cells[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+		}
+
+		bool isFull() const {
+			auto const pos = enqueuePos.load(std::memory_order_relaxed);
+			return cells[pos & mask].sequence.load(std::memory_order_acquire) != pos;
+		}
+
+		std::vector<Cell> cells;
+		size_t const mask;
+
+		char padding0[64];
+		std::atomic<size_t> enqueuePos;
+		char padding1[64];
+		std::atomic<size_t> dequeuePos;
+		char padding2[64];
+
+		SpinThenPark notEmpty, notFull;
+};
+
+enum QueueType {
+	QueueLocked,       //Queue: mutex-protected, unbounded
+	QueueLockFreeSPSC, //QueueSPSC: bounded, one producer and one consumer
+	QueueLockFreeMPMC  //QueueMPMC: bounded, any number of producers and consumers
+};
+
+/* capacity is ignored for unbounded queues */
+template<typename T>
+IQueue<T>* createQueue(QueueType type, size_t capacity) {
+	switch (type) {
+	case QueueLocked: return new Queue<T>;
+	case QueueLockFreeSPSC: return new QueueSPSC<T>(capacity);
+	case QueueLockFreeMPMC: return new QueueMPMC<T>(capacity);
+	default: throw std::runtime_error("Unknown queue type.");
+	}
+}
+
+}
@@ -1,66 +1,292 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <future>
+#include <memory>
+#include <mutex>
 #include <thread>
-#include "queue.hpp"
+#include <vector>
+#include "inplace_function.hpp"
+#include "queue_lock_free.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 
 namespace Signals {
 
+/* returns false when not supported on this platform */
+inline bool setThreadAffinity(std::thread &thread, int cpu) {
+#ifdef _WIN32
+	return SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuSet) == 0;
+#else
+	return false;
+#endif
+}
+
+/* pins the calling thread */
+inline bool setCurrentThreadAffinity(int cpu) {
+#ifdef _WIN32
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#elif defined(__linux__)
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+	CPU_SET(cpu, &cpuSet);
+	return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet) == 0;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Double-ended queue on a growable ring buffer: contrary to std::deque, it doesn't allocate
+ * in steady state. Not thread-safe.
+ */
+template<typename T>
+class RingDeque {
+	public:
+		RingDeque() : buffer(16), head(0), count(0) {}
+
+		bool empty() const {
+			return count == 0;
+		}
+		size_t size() const {
+			return count;
+		}
+
+		void push_back(T value) {
+			if (count == buffer.size())
+				grow();
+			buffer[(head + count) & (buffer.size() - 1)] = std::move(value);
+			count++;
+		}
+
+		T pop_back() {
+			count--;
+			return std::move(buffer[(head + count) & (buffer.size() - 1)]);
+		}
+
+		T pop_front() {
+			T value = std::move(buffer[head]);
+			head = (head + 1) & (buffer.size() - 1);
+			count--;
+			return value;
+		}
+
+	private:
+		void grow() {
+			std::vector<T> newBuffer(buffer.size() * 2);
+			for (size_t i = 0; i < count; ++i) {
+				newBuffer[i] = std::move(buffer[(head + i) & (buffer.size() - 1)]);
+			}
+			buffer.swap(newBuffer);
+			head = 0;
+		}
+
+		std::vector<T> buffer; //size is a power of 2
+		size_t head, count;
+};
+
+/**
+ * Work-stealing thread pool.
+ * Each worker owns a deque: tasks submitted from a worker are pushed on its own deque and executed LIFO,
+ * while their data is still hot in the worker cache. Idle workers steal the oldest tasks, from the other end
+ * of the deques. Tasks submitted from outside the pool go through a shared FIFO injection queue.
+ * With a single worker (e.g. ExecutorThread), all the tasks go through the injection queue: they are executed
+ * in the order they were posted, whatever the posting thread.
+ */
 class ThreadPool {
 	public:
-		ThreadPool(const unsigned threadCount = std::thread::hardware_concurrency()) {
-			done = false;
-			waitAndExit = false;
-			for (unsigned i = 0; i < threadCount; ++i) {
-				threads.push_back(std::thread(&ThreadPool::run, this));
+		/* tasks are stored inline: posting never allocates */
+		static const size_t TaskCapacity = 96;
+		typedef InplaceFunction<void(void), TaskCapacity> Task;
+
+		struct WorkerStats {
+			uint64_t numExecuted;  //tasks run by this worker (including stolen ones)
+			uint64_t numSteals;    //tasks this worker stole from other workers
+			uint64_t idleTimeInUs; //time spent parked waiting for work
+			size_t queueLength;    //tasks currently in the worker deque
+		};
+
+		/* cpuAffinity: optional CPU index per worker (a negative value leaves the worker unpinned) */
+		ThreadPool(const unsigned threadCount = std::thread::hardware_concurrency(), const std::vector<int> &cpuAffinity = std::vector<int>())
+			: numPendingTasks(0), stopping(false) {
+			auto const numWorkers = threadCount ? threadCount : 1;
+			for (unsigned i = 0; i < numWorkers; ++i) {
+				workers.push_back(std::unique_ptr<Worker>(new Worker));
+			}
+			for (unsigned i = 0; i < numWorkers; ++i) {
+				workers[i]->thread = std::thread(&ThreadPool::run, this, i);
+				if (i < cpuAffinity.size() && cpuAffinity[i] >= 0)
+					setThreadAffinity(workers[i]->thread, cpuAffinity[i]);
 			}
 		}
 
 		~ThreadPool() {
 			WaitForCompletion();
-			done = true;
 		}
 
+		/* executes all the pending tasks, then stops the workers */
 		void WaitForCompletion() {
-			waitAndExit = true;
-			for (size_t i = 0; i < threads.size(); ++i) {
-				workQueue.push([] {});
-			}
-			for (size_t i = 0; i < threads.size(); ++i) {
-				if (threads[i].joinable()) {
-					threads[i].join();
+			stopping = true;
+			workAvailable.notify();
+			for (auto &worker : workers) {
+				if (worker->thread.joinable()) {
+					worker->thread.join();
 				}
 			}
 		}
 
 		template<typename Callback, typename... Args>
-		std::shared_future<Callback> submit(const std::function<Callback(Args...)> &callback, Args... args)	{
-			const std::shared_future<Callback> &future = std::async(std::launch::deferred, callback, args...);
-			std::function<void(void)> f = [future]() {
-				future.get();
-			};
-			workQueue.push(f);
+		std::shared_future<Callback> submit(const std::function<Callback(Args...)> &callback, const Args&... args) {
+			auto task = std::make_shared<std::packaged_task<Callback()>>([callback, args...]() {
+				return callback(args...);
+			});
+			const std::shared_future<Callback> future = task->get_future();
+			post([task]() {
+				(*task)();
+			});
 			return future;
 		}
 
+		/* fire-and-forget: no future is created */
+		void post(Task task) {
+			auto const current = getCurrentWorker();
+			if (current.pool == this && workers.size() > 1) {
+				auto &worker = *workers[current.index];
+				std::lock_guard<std::mutex> lock(worker.mutex);
+				worker.tasks.push_back(std::move(task));
+			} else {
+				std::lock_guard<std::mutex> lock(injectedMutex);
+				injectedTasks.push_back(std::move(task));
+			}
+			numPendingTasks++;
+			workAvailable.notify();
+		}
+
+		bool isCurrentThreadWorker() const {
+			return getCurrentWorker().pool == this;
+		}
+
+		size_t getNumWorkers() const {
+			return workers.size();
+		}
+
+		std::vector<WorkerStats> getStats() const {
+			std::vector<WorkerStats> stats;
+			for (auto &worker : workers) {
+				WorkerStats s;
+				s.numExecuted = worker->numExecuted;
+				s.numSteals = worker->numSteals;
+				s.idleTimeInUs = worker->idleTimeInUs;
+				{
+					std::lock_guard<std::mutex> lock(worker->mutex);
+					s.queueLength = worker->tasks.size();
+				}
+				stats.push_back(s);
+			}
+			return stats;
+		}
+
+		size_t getInjectedQueueLength() const {
+			std::lock_guard<std::mutex> lock(injectedMutex);
+			return injectedTasks.size();
+		}
+
 	private:
 		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator= (const ThreadPool&) = delete;
+
+		struct Worker {
+			Worker() : numExecuted(0), numSteals(0), idleTimeInUs(0) {}
+			mutable std::mutex mutex;
+			RingDeque<Task> tasks; //protected by mutex
+			std::atomic<uint64_t> numExecuted, numSteals, idleTimeInUs;
+			std::thread thread;
+		};
+
+		struct CurrentWorker {
+			ThreadPool *pool;
+			size_t index;
+		};
+
+		static CurrentWorker& getCurrentWorker() {
+			static thread_local CurrentWorker current = { nullptr, 0 };
+			return current;
+		}
+
+		bool popLocal(size_t idx, Task &task) {
+			auto &worker = *workers[idx];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			if (worker.tasks.empty())
+				return false;
+			task = worker.tasks.pop_back();
+			return true;
+		}
+
+		bool popInjected(Task &task) {
+			std::lock_guard<std::mutex> lock(injectedMutex);
+			if (injectedTasks.empty())
+				return false;
+			task = injectedTasks.pop_front();
+			return true;
+		}
+
+		bool steal(size_t idx, Task &task) {
+			for (size_t i = 1; i < workers.size(); ++i) {
+				auto &victim = *workers[(idx + i) % workers.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.tasks.empty()) {
+					task = victim.tasks.pop_front();
+					workers[idx]->numSteals++;
+					return true;
+				}
+			}
+			return false;
+		}
 
-		void run() {
-			while (!done) {
-				std::function<void(void)> task = workQueue.pop();
-				task();
-				if (waitAndExit) {
-					done = true;
+		void run(size_t idx) {
+			getCurrentWorker().pool = this;
+			getCurrentWorker().index = idx;
+			auto &worker = *workers[idx];
+			Task task;
+			for (;;) {
+				if (popLocal(idx, task) || popInjected(task) || steal(idx, task)) {
+					numPendingTasks--;
+					task();
+					task = nullptr;
+					worker.numExecuted++;
+				} else if (stopping && numPendingTasks == 0) {
+					break;
+				} else {
+					auto const idleStart = std::chrono::high_resolution_clock::now();
+					workAvailable.wait([&] {
+						return numPendingTasks > 0 || stopping;
+					});
+					worker.idleTimeInUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - idleStart).count();
 				}
 			}
 		}
 
-		std::atomic_bool done, waitAndExit;
-		Queue<std::function<void(void)>> workQueue;
-		std::vector<std::thread> threads;
+		std::vector<std::unique_ptr<Worker>> workers;
+		mutable std::mutex injectedMutex;
+		RingDeque<Task> injectedTasks; //protected by injectedMutex
+		std::atomic<size_t> numPendingTasks;
+		std::atomic_bool stopping;
+		SpinThenPark workAvailable;
 };
 }
@@ -1,64 +1,197 @@
 #pragma once
 
 #include <cstdint>
+#include <cstdio>
+#include <initializer_list>
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 
 #define FORMAT(i, max) std::setw(1+(std::streamsize)log10(max)) << i
 
+/* Text form of the values, as written by std::ostream, appended without streams for the common types.
+   The overload is selected at compile time from the decayed argument type. */
+namespace FormatValue {
+struct String {};
+struct Char {};
+struct Bool {};
+struct Integer {};
+struct Float {};
+struct Vector {};
+struct Stream {};
+
+template<typename T> struct Category {
+	typedef typename std::conditional<std::is_floating_point<T>::value, Float,
+	        typename std::conditional<std::is_integral<T>::value, Integer, Stream>::type>::type type;
+};
+template<> struct Category<std::string> { typedef String type; };
+template<> struct Category<const char*> { typedef String type; };
+template<> struct Category<char*> { typedef String type; };
+template<> struct Category<char> { typedef Char type; };
+template<> struct Category<signed char> { typedef Char type; };
+template<> struct Category<bool> { typedef Bool type; };
+template<typename T> struct Category<std::vector<T>> { typedef Vector type; };
+}
+
 template<typename T>
-std::string toString(T const& val) {
-	std::stringstream ss;
-	ss << val;
-	return ss.str();
+void appendValue(std::string &out, T const& val);
+
+namespace FormatValue {
+inline void append(std::string &out, const std::string &val, String) {
+	out += val;
+}
+inline void append(std::string &out, const char *val, String) {
+	out += val;
+}
+inline void append(std::string &out, char val, Char) {
+	out += val;
+}
+inline void append(std::string &out, bool val, Bool) {
+	out += val ? '1' : '0';
 }
 
-inline std::string toString(uint8_t val) {
-	std::stringstream ss;
-	ss << (int)val;
-	return ss.str();
+template<typename T>
+bool isNegative(T val, std::true_type /*signed*/) {
+	return val < 0;
+}
+template<typename T>
+bool isNegative(T, std::false_type) {
+	return false;
 }
 
 template<typename T>
-std::string toString(std::vector<T> const& val) {
-	std::stringstream ss;
-	ss << "[";
+void append(std::string &out, T val, Integer) {
+	//uint8_t is written as a number
+	char buffer[24];
+	auto p = buffer + sizeof(buffer);
+	auto const isNegative = FormatValue::isNegative(val, std::is_signed<T>());
+	auto magnitude = isNegative ? 0 - (typename std::make_unsigned<T>::type)val : (typename std::make_unsigned<T>::type)val;
+	do {
+		*--p = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+	if (isNegative)
+		*--p = '-';
+	out.append(p, buffer + sizeof(buffer));
+}
+
+template<typename T>
+void append(std::string &out, T val, Float) {
+	//the default stream precision
+	char buffer[32];
+	auto const size = snprintf(buffer, sizeof(buffer), "%g", (double)val);
+	out.append(buffer, size);
+}
+
+template<typename T>
+void append(std::string &out, std::vector<T> const& val, Vector) {
+	out += "[";
 	for (size_t i = 0; i < val.size(); ++i) {
 		if (i > 0)
-			ss << ", ";
-		ss << toString(val[i]);
+			out += ", ";
+		appendValue(out, val[i]);
 	}
-	ss << "]";
-	return ss.str();
+	out += "]";
 }
 
-inline std::string format(const std::string& format) {
-	return format;
+template<typename T>
+void append(std::string &out, T const& val, Stream) {
+	std::stringstream ss;
+	ss << val;
+	out += ss.str();
+}
 }
 
-template<typename T, typename... Arguments>
-std::string format(const std::string& fmt, const T& firstArg, Arguments... args) {
-	std::string r;
+template<typename T>
+void appendValue(std::string &out, T const& val) {
+	FormatValue::append(out, val, typename FormatValue::Category<typename std::decay<T>::type>::type());
+}
+
+template<typename T>
+std::string toString(T const& val) {
+	std::string s;
+	appendValue(s, val);
+	return s;
+}
+
+/* a type-erased reference to a format() argument: the pattern is parsed in a single pass, without recursion */
+struct FormatArg {
+	const void *value;
+	void (*append)(std::string &out, const void *value);
+};
+
+template<typename T>
+FormatArg makeFormatArg(T const& val) {
+	return { &val, [](std::string &out, const void *value) {
+			appendValue(out, *static_cast<const T*>(value));
+		}
+	};
+}
+
+/* '%s' is replaced by the next argument, '%%' by '%'. Once the arguments are exhausted, the rest of 'fmt' is copied as is. */
+inline void appendFormat(std::string &out, const char *fmt, size_t size, std::initializer_list<FormatArg> args) {
+	auto arg = args.begin();
 	size_t i = 0;
-	while (i < fmt.size()) {
+	while (i < size) {
+		if (arg == args.end()) {
+			out.append(fmt + i, size - i);
+			return;
+		}
+		auto const percent = std::char_traits<char>::find(fmt + i, size - i, '%');
+		if (!percent) {
+			out.append(fmt + i, size - i);
+			return;
+		}
+		out.append(fmt + i, percent - (fmt + i));
+		i = percent - fmt + 1;
+		if (i >= size)
+			throw std::runtime_error("Invalid fmt specifier");
 		if (fmt[i] == '%') {
-			++i;
-			if (i >= fmt.size())
-				throw std::runtime_error("Invalid fmt specifier");
-
-			if (fmt[i] == '%')
-				r += '%';
-			else if (fmt[i] == 's') {
-				r += toString(firstArg);
-				return r + format(fmt.substr(i + 1), args...);
-			}
-		} else {
-			r += fmt[i];
+			out += '%';
+		} else if (fmt[i] == 's') {
+			arg->append(out, arg->value);
+			++arg;
 		}
 		++i;
 	}
+}
+
+template<typename... Arguments>
+void appendFormat(std::string &out, const std::string &fmt, const Arguments&... args) {
+	appendFormat(out, fmt.data(), fmt.size(), { makeFormatArg(args)... });
+}
+
+template<typename... Arguments>
+void appendFormat(std::string &out, const char *fmt, const Arguments&... args) {
+	appendFormat(out, fmt, std::char_traits<char>::length(fmt), { makeFormatArg(args)... });
+}
+
+inline std::string format(const std::string& format) {
+	return format;
+}
+
+inline std::string format(const char *format) {
+	return format;
+}
+
+template<typename... Arguments>
+std::string format(const std::string& fmt, const Arguments&... args) {
+	std::string r;
+	r.reserve(fmt.size() + 16 * sizeof...(args));
+	appendFormat(r, fmt.data(), fmt.size(), { makeFormatArg(args)... });
+	return r;
+}
+
+/* literals: no std::string is built for the pattern */
+template<typename... Arguments>
+std::string format(const char *fmt, const Arguments&... args) {
+	auto const size = std::char_traits<char>::length(fmt);
+	std::string r;
+	r.reserve(size + 16 * sizeof...(args));
+	appendFormat(r, fmt, size, { makeFormatArg(args)... });
 	return r;
 }
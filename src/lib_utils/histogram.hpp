@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+/**
+ * HDR-style histogram: values are counted in log-linear buckets (HalfSubBuckets linear buckets per power of 2),
+ * so that any recorded value is known with a relative error below 1/HalfSubBuckets (~3%), in a fixed memory footprint.
+ * Recording is lock-free and can be concurrent with the reading.
+ */
+class Histogram {
+	public:
+		Histogram() {
+			reset();
+		}
+
+		void record(uint64_t value) {
+			buckets[getBucket(value)].fetch_add(1, std::memory_order_relaxed);
+			count.fetch_add(1, std::memory_order_relaxed);
+			sum.fetch_add(value, std::memory_order_relaxed);
+			auto max = maxValue.load(std::memory_order_relaxed);
+			while (value > max && !maxValue.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+			}
+		}
+
+		uint64_t getCount() const {
+			return count.load(std::memory_order_relaxed);
+		}
+		uint64_t getSum() const {
+			return sum.load(std::memory_order_relaxed);
+		}
+		uint64_t getMax() const {
+			return maxValue.load(std::memory_order_relaxed);
+		}
+
+		/* the highest value of the bucket holding the 'percentile' (0-100), 0 when empty */
+		uint64_t getPercentile(double percentile) const {
+			auto const total = getCount();
+			if (!total)
+				return 0;
+			auto const rank = std::max<uint64_t>(1, (uint64_t)(percentile / 100 * total + 0.5));
+			uint64_t cumulated = 0;
+			for (int i = 0; i < NumBuckets; ++i) {
+				cumulated += buckets[i].load(std::memory_order_relaxed);
+				if (cumulated >= rank)
+					return std::min(getBucketMax(i), getMax());
+			}
+			return getMax(); //concurrent recording
+		}
+
+		void reset() {
+			for (auto &bucket : buckets)
+				bucket = 0;
+			count = 0;
+			sum = 0;
+			maxValue = 0;
+		}
+
+	private:
+		Histogram(const Histogram&) = delete;
+		Histogram& operator= (const Histogram&) = delete;
+
+		static const int SubBucketBits = 6;
+		static const int SubBuckets = 1 << SubBucketBits;
+		static const int HalfSubBuckets = SubBuckets / 2;
+		//values below SubBuckets are exact, then each power of 2 has HalfSubBuckets buckets
+		static const int NumBuckets = SubBuckets + (64 - SubBucketBits) * HalfSubBuckets;
+
+		static int getMostSignificantBit(uint64_t value) {
+			int msb = 0;
+			while (value >>= 1)
+				msb++;
+			return msb;
+		}
+
+		static int getBucket(uint64_t value) {
+			if (value < (uint64_t)SubBuckets)
+				return (int)value;
+			auto const shift = getMostSignificantBit(value) - SubBucketBits + 1;
+			auto const subBucket = (int)(value >> shift); //in [HalfSubBuckets; SubBuckets)
+			return SubBuckets + (shift - 1) * HalfSubBuckets + subBucket - HalfSubBuckets;
+		}
+
+		static uint64_t getBucketMax(int bucket) {
+			if (bucket < SubBuckets)
+				return bucket;
+			auto const shift = (bucket - SubBuckets) / HalfSubBuckets + 1;
+			auto const subBucket = (uint64_t)((bucket - SubBuckets) % HalfSubBuckets + HalfSubBuckets);
+			return ((subBucket + 1) << shift) - 1;
+		}
+
+		std::atomic<uint64_t> buckets[NumBuckets];
+		std::atomic<uint64_t> count, sum, maxValue;
+};
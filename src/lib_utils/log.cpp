@@ -1,8 +1,12 @@
 #include "log.hpp"
+#include <atomic>
 #include <cassert>
 #include <chrono>
-#include <iostream>
-#include <string>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -31,54 +35,256 @@ uint64_t now() {
 	return timeNowInMs.count();
 }
 
-}
-
+std::atomic<FILE*> g_output(nullptr);
 
-std::ostream& Log::get(Level /*level*/) {
-	return std::cerr;
+FILE* getOutput() {
+	auto const output = g_output.load();
+	return output ? output : stderr;
 }
 
-std::string Log::getTime() {
-	return format("[%s] ", now()/1000.0);
+#ifndef _WIN32
+const char* getColor(Level level) {
+	switch (level) {
+	case Error: return RED;
+	case Warning: return YELLOW;
+	case Info: return GREEN;
+	case Debug: return CYAN;
+	default: return "";
+	}
 }
+#endif
+
+/* bounded multi-producer single-consumer ring (sequence numbers per slot, as in D. Vyukov's bounded queue) */
+class Backend {
+	public:
+		Backend() : slots(NumSlots), enqueuePos(0), dequeuePos(0), numDropped(0), numWritten(0), stopping(false), wakeUp(false) {
+			for (size_t i = 0; i < NumSlots; ++i)
+				slots[i].sequence.store(i, std::memory_order_relaxed);
+			thread = std::thread(&Backend::run, this);
+		}
+		~Backend() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			condition.notify_one();
+			thread.join();
+		}
+
+		void* acquire(Level level) {
+			auto pos = enqueuePos.load(std::memory_order_relaxed);
+			for (;;) {
+				auto &slot = slots[pos & (NumSlots - 1)];
+				auto const seq = slot.sequence.load(std::memory_order_acquire);
+				auto const diff = (intptr_t)seq - (intptr_t)pos;
+				if (diff == 0) {
+					if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						slot.level = level;
+						slot.timeInMs = now();
+						return &slot.storage;
+					}
+				} else if (diff < 0) {
+					//full: errors wait for the writer, other levels are dropped
+					if (level != Error || std::this_thread::get_id() == thread.get_id()) {
+						numDropped++;
+						return nullptr;
+					}
+					notify();
+					std::this_thread::yield();
+					pos = enqueuePos.load(std::memory_order_relaxed);
+				} else {
+					pos = enqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void release(void *storage, bool constructed) {
+			auto &slot = *reinterpret_cast<Slot*>(storage);
+			slot.constructed = constructed;
+			auto const pos = slot.sequence.load(std::memory_order_relaxed);
+			slot.sequence.store(pos + 1, std::memory_order_release);
+		}
 
-std::string Log::getColorBegin(Level level) {
+		void flush() {
+			if (std::this_thread::get_id() == thread.get_id())
+				return; //logging while formatting: we are the writer
+			auto const target = enqueuePos.load();
+			notify();
+			std::unique_lock<std::mutex> lock(mutex);
+			flushed.wait(lock, [&]() {
+				return numWritten >= target || stopping;
+			});
+		}
+
+	private:
+		static const size_t NumSlots = 2048; //power of 2
+
+		struct Slot {
+			std::aligned_storage<Log::MaxMessageSize, alignof(std::max_align_t)>::type storage; //first: see release()
+			std::atomic<size_t> sequence;
+			Level level;
+			bool constructed;
+			uint64_t timeInMs;
+		};
+
+		void notify() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				wakeUp = true;
+			}
+			condition.notify_one();
+		}
+
+		void run() {
+			std::string batch;
+			for (;;) {
+				bool stop;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					condition.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+						return wakeUp || stopping;
+					});
+					wakeUp = false;
+					stop = stopping;
+				}
+				while (drain(batch)) {
+				}
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					numWritten = dequeuePos;
+				}
+				flushed.notify_all();
+				if (stop)
+					return;
+			}
+		}
+
+		/* writes the queued messages at once: returns false when there was none */
+		bool drain(std::string &batch) {
+			batch.clear();
+			auto const dropped = numDropped.exchange(0);
+			if (dropped)
+				append(batch, Warning, now(), format("[Log] %s messages dropped: the log ring is full", dropped));
+			size_t numMessages = 0;
+			for (;;) {
+				auto &slot = slots[dequeuePos & (NumSlots - 1)];
+				if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+					break;
+				if (slot.constructed) {
+					auto message = reinterpret_cast<Log::IMessage*>(&slot.storage);
+					std::string text;
+					try {
+						message->write(text);
+					} catch (std::exception const& e) {
+						text = format("[Log] invalid message: %s", e.what());
+					}
+					message->~IMessage();
+					append(batch, slot.level, slot.timeInMs, text);
+				}
+				slot.sequence.store(dequeuePos + NumSlots, std::memory_order_release);
+				dequeuePos++;
+				numMessages++;
+			}
+#ifndef _WIN32
+			if (!batch.empty()) {
+				fwrite(batch.data(), 1, batch.size(), getOutput());
+				fflush(getOutput());
+			}
+#endif
+			return numMessages > 0;
+		}
+
+		void append(std::string &batch, Level level, uint64_t timeInMs, const std::string &text) {
 #ifdef _WIN32
-	if (console == NULL) {
-		CONSOLE_SCREEN_BUFFER_INFO console_info;
-		console = GetStdHandle(STD_ERROR_HANDLE);
-		assert(console != INVALID_HANDLE_VALUE);
-		if (console != INVALID_HANDLE_VALUE) {
-			GetConsoleScreenBufferInfo(console, &console_info);
-			console_attr_ori = console_info.wAttributes;
+			auto const line = format("[%s] %s\n", timeInMs / 1000.0, text);
+			if (console == NULL) {
+				CONSOLE_SCREEN_BUFFER_INFO console_info;
+				console = GetStdHandle(STD_ERROR_HANDLE);
+				assert(console != INVALID_HANDLE_VALUE);
+				if (console != INVALID_HANDLE_VALUE) {
+					GetConsoleScreenBufferInfo(console, &console_info);
+					console_attr_ori = console_info.wAttributes;
+				}
+			}
+			switch (level) {
+			case Error: SetConsoleTextAttribute(console, FOREGROUND_RED | FOREGROUND_INTENSITY); break;
+			case Warning: SetConsoleTextAttribute(console, FOREGROUND_INTENSITY | FOREGROUND_RED | FOREGROUND_GREEN); break;
+			case Info: SetConsoleTextAttribute(console, FOREGROUND_INTENSITY | FOREGROUND_GREEN); break;
+			case Debug: SetConsoleTextAttribute(console, FOREGROUND_GREEN); break;
+			default: break;
+			}
+			//the console attributes apply to the text written until they change: no batching
+			fwrite(line.data(), 1, line.size(), getOutput());
+			fflush(getOutput());
+			SetConsoleTextAttribute(console, console_attr_ori);
+#else
+			batch += getColor(level);
+			batch += format("[%s] ", timeInMs / 1000.0);
+			batch += text;
+			batch += RESET "\n";
+#endif
 		}
+
+		std::vector<Slot> slots;
+		std::atomic<size_t> enqueuePos;
+		size_t dequeuePos; //writer thread only
+		std::atomic<uint64_t> numDropped;
+		size_t numWritten; //protected by mutex
+		bool stopping, wakeUp; //protected by mutex
+		std::mutex mutex;
+		std::condition_variable condition, flushed;
+		std::thread thread;
+};
+
+/* the messages logged during the static destruction, once the backend is gone, are written synchronously */
+std::atomic_bool g_backendDestroyed(false);
+
+struct BackendHolder {
+	Backend backend;
+	~BackendHolder() {
+		g_backendDestroyed = true;
 	}
-	switch (level) {
-	case Error: SetConsoleTextAttribute(console, FOREGROUND_RED | FOREGROUND_INTENSITY); break;
-	case Warning: SetConsoleTextAttribute(console, FOREGROUND_INTENSITY | FOREGROUND_RED | FOREGROUND_GREEN); break;
-	case Info: SetConsoleTextAttribute(console, FOREGROUND_INTENSITY | FOREGROUND_GREEN); break;
-	case Debug: SetConsoleTextAttribute(console, FOREGROUND_GREEN); break;
-	default: break;
+};
+
+BackendHolder& getHolder() {
+	static BackendHolder holder;
+	return holder;
+}
+
+Backend* getBackend() {
+	if (g_backendDestroyed)
+		return nullptr;
+	return &getHolder().backend;
+}
+
+/* fallback when the backend is gone */
+thread_local std::aligned_storage<Log::MaxMessageSize, alignof(std::max_align_t)>::type t_syncStorage;
+
+}
+
+void* Log::acquire(Level level) {
+	if (auto backend = getBackend())
+		return backend->acquire(level);
+	return &t_syncStorage;
+}
+
+void Log::release(void *storage, bool constructed) {
+	if (storage != &t_syncStorage) {
+		getHolder().backend.release(storage, constructed); //may be destroying: it is drained last
+		return;
 	}
-#else
-	switch (level) {
-	case Error: fprintf(stderr, RED); break;
-	case Warning: fprintf(stderr, YELLOW); break;
-	case Info: fprintf(stderr, GREEN); break;
-	case Debug: fprintf(stderr, CYAN); break;
-	default: break;
+	if (constructed) {
+		auto message = reinterpret_cast<IMessage*>(storage);
+		std::string text;
+		message->write(text);
+		message->~IMessage();
+		fprintf(getOutput(), "[%.3f] %s\n", now() / 1000.0, text.c_str());
 	}
-#endif
-	return "";
 }
 
-std::string Log::getColorEnd(Level level) {
-#ifdef _WIN32
-	SetConsoleTextAttribute(console, console_attr_ori);
-#else
-	fprintf(stderr, RESET);
-#endif
-	return "";
+void Log::flush() {
+	if (auto backend = getBackend())
+		backend->flush();
 }
 
 void Log::setLevel(Level level) {
@@ -88,3 +294,7 @@ void Log::setLevel(Level level) {
 Level Log::getLevel() {
 	return globalLogLevel;
 }
+
+void Log::setOutput(FILE *file) {
+	g_output = file;
+}
@@ -1,7 +1,14 @@
 #pragma once
 
 #include "format.hpp"
-#include <ostream>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 enum Level {
 	Quiet = -1,
@@ -11,26 +18,123 @@ enum Level {
 	Debug
 };
 
+/* the queued arguments are copies: C strings are copied as std::string */
+template<typename T> struct LogArgument {
+	typedef T type;
+};
+template<> struct LogArgument<const char*> {
+	typedef std::string type;
+};
+template<> struct LogArgument<char*> {
+	typedef std::string type;
+};
+
+/**
+ * Messages are queued into a lock-free ring and written by a background thread, in batches.
+ * A disabled level costs one branch: the arguments are neither copied nor formatted.
+ * Enabled, the arguments are copied and formatted by the background thread. The ring slots fit a message with a
+ * few strings: larger messages are allocated aside.
+ * Errors are written before msg() returns, so that they are not lost on a crash or an abort.
+ */
 class Log {
 	public:
+		/* 'fmt' is a literal: only its address is queued */
+		template<size_t N, typename... Arguments>
+		static void msg(Level level, const char (&fmt)[N], const Arguments&... args) {
+			if (isEnabled(level))
+				push<const char*>(level, fmt, args...);
+		}
+		/* a local buffer may not outlive the call: use a std::string */
+		template<size_t N, typename... Arguments>
+		static void msg(Level level, char (&fmt)[N], const Arguments&... args) = delete;
 		template<typename... Arguments>
-		static void msg(Level level, const std::string& fmt, Arguments... args) {
-			if ((level != Quiet) && (level <= globalLogLevel)) {
-				get(level) << getColorBegin(level) << getTime() << format(fmt, args...) << getColorEnd(level) << std::endl;
-				get(level).flush();
-			}
+		static void msg(Level level, const std::string& fmt, const Arguments&... args) {
+			if (isEnabled(level))
+				push<std::string>(level, fmt, args...);
 		}
 
-		void setLevel(Level level);
-		Level getLevel();
+		static bool isEnabled(Level level) {
+			return level != Quiet && level <= globalLogLevel;
+		}
+		static void setLevel(Level level);
+		static Level getLevel();
+		/* nullptr (the default) is stderr */
+		static void setOutput(FILE *file);
+
+		/* returns once the messages queued so far are written */
+		static void flush();
+
+		/* a queued message: formats itself on the background thread */
+		struct IMessage {
+			virtual ~IMessage() {}
+			virtual void write(std::string &out) = 0;
+		};
+		static const size_t MaxMessageSize = 192; //the format string and 4 std::string arguments
 
 	private:
-		Log();
-		~Log();
-		static std::ostream& get(Level level);
-		static std::string getTime();
-		static std::string getColorBegin(Level level);
-		static std::string getColorEnd(Level level);
+		Log() = delete;
+
+		template<typename Fmt, typename... Arguments>
+		class Message : public IMessage {
+			public:
+				Message(const Fmt &fmt, const Arguments&... args) : fmt(fmt), args(args...) {}
+				void write(std::string &out) override {
+					write(out, std::index_sequence_for<Arguments...>());
+				}
+
+			private:
+				template<size_t... I>
+				void write(std::string &out, std::index_sequence<I...>) {
+					appendFormat(out, fmt, std::get<I>(args)...);
+				}
+
+				Fmt fmt;
+				std::tuple<Arguments...> args;
+		};
+
+		class SpilledMessage : public IMessage {
+			public:
+				SpilledMessage(IMessage *message) : message(message) {}
+				void write(std::string &out) override {
+					message->write(out);
+				}
+
+			private:
+				std::unique_ptr<IMessage> message;
+		};
+
+		template<typename Fmt, typename... Arguments>
+		static void push(Level level, const Fmt &fmt, const Arguments&... args) {
+			typedef Message<Fmt, typename LogArgument<typename std::decay<Arguments>::type>::type...> M;
+			auto storage = acquire(level);
+			if (!storage)
+				return;
+			try {
+				construct<M>(storage, std::integral_constant<bool, sizeof(M) <= MaxMessageSize>(), fmt, args...);
+			} catch (...) {
+				release(storage, false);
+				throw;
+			}
+			release(storage, true);
+			if (level == Error)
+				flush();
+		}
+
+		template<typename M, typename Fmt, typename... Arguments>
+		static void construct(void *storage, std::true_type, const Fmt &fmt, const Arguments&... args) {
+			new (storage) M(fmt, args...);
+		}
+		/* too large for a slot: allocated aside, still formatted by the background thread */
+		template<typename M, typename Fmt, typename... Arguments>
+		static void construct(void *storage, std::false_type, const Fmt &fmt, const Arguments&... args) {
+			std::unique_ptr<IMessage> message(new M(fmt, args...));
+			new (storage) SpilledMessage(message.release()); //doesn't throw
+		}
+
+		/* reserves a slot of MaxMessageSize bytes in the ring: nullptr when the message is dropped (full ring) */
+		static void* acquire(Level level);
+		/* publishes the slot to the background thread */
+		static void release(void *storage, bool constructed);
 
 		static Level globalLogLevel;
 };
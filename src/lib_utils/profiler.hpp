@@ -10,11 +10,30 @@
 #else
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 #endif
 
 
 namespace Tools {
 
+/* CPU time consumed so far by the calling thread */
+inline uint64_t getThreadCpuTimeInUs() {
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return 0;
+	auto const toUs = [](const FILETIME &t) {
+		return ((uint64_t)t.dwHighDateTime << 32 | t.dwLowDateTime) / 10;
+	};
+	return toUs(kernelTime) + toUs(userTime);
+#else
+	struct timespec t;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t))
+		return 0;
+	return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+#endif
+}
+
 class Profiler {
 	public:
 		Profiler(const std::string &name) : name(name) {
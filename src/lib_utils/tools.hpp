@@ -77,6 +77,37 @@ std::vector<T> apply(Lambda func, std::vector<T>& input, Arguments... args) {
 	return r;
 }
 
+// Non-owning view over contiguous elements.
+template<typename T>
+struct span {
+	span() : ptr(nullptr), len(0) {}
+	span(T *ptr, size_t len) : ptr(ptr), len(len) {}
+	template<typename U>
+	span(std::vector<U> &v) : ptr(v.data()), len(v.size()) {}
+	template<typename U>
+	span(const std::vector<U> &v) : ptr(v.data()), len(v.size()) {}
+
+	T* begin() const {
+		return ptr;
+	}
+	T* end() const {
+		return ptr + len;
+	}
+	T& operator[](size_t i) const {
+		return ptr[i];
+	}
+	size_t size() const {
+		return len;
+	}
+	bool empty() const {
+		return len == 0;
+	}
+
+private:
+	T *ptr;
+	size_t len;
+};
+
 template<typename T>
 std::unique_ptr<T> uptr(T* p) {
 	return std::unique_ptr<T>(p);
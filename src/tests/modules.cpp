@@ -2,8 +2,13 @@
 #include "lib_modules/modules.hpp"
 
 //#define ENABLE_FAILING_TESTS
+//#define ENABLE_PERF_TESTS
 
+#include "modules_allocator.cpp"
+#include "modules_buffer.cpp"
 #include "modules_fifo.cpp"
+#include "modules_input.cpp"
+#include "modules_metadata.cpp"
 #include "modules_simple.cpp"
 #include "modules_clock.cpp"
 #include "modules_converter.cpp"
@@ -17,5 +22,8 @@
 #include "modules_player.cpp"
 #include "modules_render.cpp"
 #include "modules_transcoder.cpp"
+#ifdef ENABLE_PERF_TESTS
+#include "modules_perf.cpp"
+#endif
 
 using namespace Tests;
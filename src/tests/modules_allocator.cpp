@@ -0,0 +1,247 @@
+#include "tests.hpp"
+#include "lib_modules/modules.hpp"
+#include "lib_media/in/file.hpp"
+#include "lib_utils/tools.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+using namespace Tests;
+using namespace Modules;
+
+namespace {
+
+typedef PacketAllocator<DataRaw> Allocator;
+
+template<typename Allocator>
+std::shared_ptr<DataRaw> getBufferNow(Allocator &allocator, size_t size, AllocatorFallback fallback = AllocatorReturnNull) {
+	return allocator.template getBuffer<DataRaw>(size, std::chrono::microseconds(0), fallback);
+}
+
+/* limits the global budget to the memory currently used plus extraBytes */
+struct ScopedMemoryBudget {
+	ScopedMemoryBudget(uint64_t extraBytes, MemoryBudgetPolicy policy) {
+		auto &budget = MemoryBudget::global();
+		budget.setPolicy(policy);
+		budget.setLimit(budget.getStats().usedBytes + extraBytes);
+	}
+	~ScopedMemoryBudget() {
+		MemoryBudget::global().setLimit(0);
+		MemoryBudget::global().setPolicy(MemoryBudgetBlock);
+	}
+};
+
+}
+
+unittest("allocator: blocks are recycled") {
+	Allocator allocator(2);
+	auto buffer = allocator.getBuffer<DataRaw>(100);
+	auto const data = buffer.get();
+	buffer = nullptr;
+	ASSERT(allocator.getBuffer<DataRaw>(50).get() == data);
+}
+
+unittest("allocator: size classes share the number of blocks") {
+	for (auto freeListType : { Signals::QueueLocked, Signals::QueueLockFreeMPMC }) {
+		Allocator allocator(2, freeListType);
+		auto small1 = allocator.getBuffer<DataRaw>(200);
+		auto small2 = allocator.getBuffer<DataRaw>(200);
+		ASSERT(!getBufferNow(allocator, 200));
+		ASSERT(!getBufferNow(allocator, 3840 * 2160 * 3 / 2));
+		small2 = nullptr;
+		auto picture = getBufferNow(allocator, 3840 * 2160 * 3 / 2); //the idle small block makes room
+		ASSERT(picture);
+		ASSERT(picture->size() == 3840 * 2160 * 3 / 2);
+		ASSERT_EQUALS(2u, allocator.getStats().numBlocksInFlight);
+		ASSERT_EQUALS(200u + 3840 * 2160 * 3 / 2, allocator.getStats().numBytes);
+	}
+}
+
+unittest("allocator: blocks recycled by another thread are available to the allocating thread") {
+	Allocator allocator(ALLOC_NUM_BLOCKS_LOW_LATENCY);
+	for (int i = 0; i < 100; ++i) {
+		auto buffer = getBufferNow(allocator, 100);
+		ASSERT(buffer);
+		std::thread([&] {
+			buffer = nullptr;
+		}).join();
+	}
+	ASSERT_EQUALS(100u, allocator.getStats().numBytes);
+}
+
+unittest("allocator: timeout with fallbacks") {
+	Allocator allocator(1);
+	auto buffer = allocator.getBuffer<DataRaw>(10);
+	ASSERT(!allocator.getBuffer<DataRaw>(10, std::chrono::microseconds(1000), AllocatorReturnNull));
+	auto extra = allocator.getBuffer<DataRaw>(10, std::chrono::microseconds(1000), AllocatorUseHeap);
+	ASSERT(extra);
+	extra = nullptr;
+	ASSERT(!getBufferNow(allocator, 10));
+	buffer = nullptr;
+	ASSERT(getBufferNow(allocator, 10));
+}
+
+unittest("allocator: a blocked getBuffer() is woken up by a recycle from another thread") {
+	Allocator allocator(1);
+	auto buffer = allocator.getBuffer<DataRaw>(10);
+	std::thread recycler([&] {
+		SLEEP_IN_MS(10);
+		buffer = nullptr;
+	});
+	ASSERT(allocator.getBuffer<DataRaw>(10));
+	recycler.join();
+}
+
+unittest("allocator: unblock() wakes up a blocked getBuffer()") {
+	Allocator allocator(1);
+	auto buffer = allocator.getBuffer<DataRaw>(10);
+	std::thread unblocker([&] {
+		SLEEP_IN_MS(10);
+		allocator.unblock();
+	});
+	ASSERT(!allocator.getBuffer<DataRaw>(10));
+	unblocker.join();
+}
+
+unittest("allocator: stats") {
+	Allocator allocator(2);
+	auto b1 = allocator.getBuffer<DataRaw>(100);
+	auto b2 = allocator.getBuffer<DataRaw>(100);
+	auto stats = allocator.getStats();
+	ASSERT_EQUALS(2u, stats.numBlocks);
+	ASSERT_EQUALS(2u, stats.numBlocksInFlight);
+	ASSERT_EQUALS(2u, stats.highWaterMark);
+	ASSERT_EQUALS(200u, stats.numBytes);
+	ASSERT_EQUALS(0u, stats.numResizes);
+
+	b1 = nullptr;
+	b1 = allocator.getBuffer<DataRaw>(150);
+	b2->resize(50);
+	b2 = nullptr;
+	stats = allocator.getStats();
+	ASSERT_EQUALS(1u, stats.numBlocksInFlight);
+	ASSERT_EQUALS(2u, stats.highWaterMark);
+	ASSERT_EQUALS(200u, stats.numBytes);
+	ASSERT_EQUALS(1u, stats.numResizes);
+	ASSERT_EQUALS(0u, stats.blockedTimeInUs);
+
+	auto b3 = allocator.getBuffer<DataRaw>(10);
+	ASSERT(allocator.getBuffer<DataRaw>(10, std::chrono::microseconds(5000), AllocatorUseHeap));
+	stats = allocator.getStats();
+	ASSERT_EQUALS(1u, stats.numHeapFallbacks);
+	ASSERT(stats.blockedTimeInUs >= 5000);
+}
+
+unittest("allocator: allocations per frame in steady state") {
+	auto output = uptr(new OutputDefault(ALLOC_NUM_BLOCKS_DEFAULT));
+	uint64_t sum = 0;
+	output->getSignal().connect([&](Data data) {
+		sum += data->getTime();
+	});
+	auto const numFrames = 1000;
+	uint64_t numAllocations = 0;
+	for (int i = 0; i < 2 * numFrames; ++i) {
+		if (i == numFrames)
+			numAllocations = getNumAllocations(); //warmed up
+		auto buffer = output->getBuffer(1024);
+		buffer->setTime(i);
+		output->emit(buffer);
+	}
+	numAllocations = getNumAllocations() - numAllocations;
+	std::cout << "allocations per frame: " << numAllocations / (double)numFrames << std::endl;
+	ASSERT_EQUALS(0u, numAllocations);
+	ASSERT_EQUALS((uint64_t)numFrames * (2 * numFrames - 1), sum);
+}
+
+unittest("allocator: the pool grows with the observed depth") {
+	Allocator allocator(10);
+	for (int i = 0; i < 100; ++i) {
+		auto buffer = allocator.getBuffer<DataRaw>(100);
+		std::thread([&] {
+			buffer = nullptr;
+		}).join();
+	}
+	ASSERT_EQUALS(100u, allocator.getStats().numBytes);
+}
+
+unittest("memory budget: blocks are accounted in bytes") {
+	auto const usedBytes = MemoryBudget::global().getStats().usedBytes;
+	{
+		Allocator allocator(2);
+		auto buffer = allocator.getBuffer<DataRaw>(1000);
+		ASSERT_EQUALS(usedBytes + 1000, MemoryBudget::global().getStats().usedBytes);
+		buffer->resize(3000);
+		buffer = nullptr;
+		ASSERT_EQUALS(usedBytes + 3000, MemoryBudget::global().getStats().usedBytes);
+	}
+	ASSERT_EQUALS(usedBytes, MemoryBudget::global().getStats().usedBytes);
+}
+
+unittest("memory budget: idle blocks of other allocators are trimmed") {
+	ScopedMemoryBudget scopedBudget(1500, MemoryBudgetDrop);
+	Allocator idle(2), busy(2);
+	idle.getBuffer<DataRaw>(1000);
+	ASSERT_EQUALS(1000u, idle.getStats().numBytes);
+	auto const trimmedBytes = MemoryBudget::global().getStats().trimmedBytes;
+	ASSERT(busy.getBuffer<DataRaw>(1000));
+	ASSERT_EQUALS(0u, idle.getStats().numBytes);
+	ASSERT_EQUALS(trimmedBytes + 1000, MemoryBudget::global().getStats().trimmedBytes);
+}
+
+unittest("memory budget: drop and spill policies") {
+	ScopedMemoryBudget scopedBudget(1000, MemoryBudgetDrop);
+	Allocator allocator(4);
+	auto buffer = allocator.getBuffer<DataRaw>(1000);
+	auto const numDropped = MemoryBudget::global().getStats().numDropped;
+	ASSERT(!allocator.getBuffer<DataRaw>(1000));
+	ASSERT_EQUALS(numDropped + 1, MemoryBudget::global().getStats().numDropped);
+
+	MemoryBudget::global().setPolicy(MemoryBudgetSpill);
+	auto const usedBytes = MemoryBudget::global().getStats().usedBytes;
+	auto spilled = allocator.getBuffer<DataRaw>(1000);
+	ASSERT(spilled);
+	ASSERT_EQUALS(1u, allocator.getStats().numHeapFallbacks);
+	ASSERT_EQUALS(usedBytes, MemoryBudget::global().getStats().usedBytes);
+}
+
+unittest("memory budget: with the drop policy, producers skip the data") {
+	const char *path = "memory_budget_drop.bin";
+	{
+		auto f = fopen(path, "wb");
+		ASSERT(f);
+		std::vector<uint8_t> chunk(100 * 1024);
+		fwrite(chunk.data(), 1, chunk.size(), f);
+		fclose(f);
+	}
+	int numChunks = 0;
+	auto onChunk = [&](Data) {
+		numChunks++;
+	};
+	{
+		ScopedMemoryBudget scopedBudget(1000, MemoryBudgetDrop);
+		auto const numDropped = MemoryBudget::global().getStats().numDropped;
+		auto file = uptr(create<In::File>(path));
+		Connect(file->getOutput(0)->getSignal(), onChunk);
+		file->process(nullptr);
+		ASSERT_EQUALS(numDropped + 2, MemoryBudget::global().getStats().numDropped);
+	}
+	std::remove(path);
+	ASSERT_EQUALS(0, numChunks);
+}
+
+unittest("memory budget: a blocked getBuffer() is woken up when memory is released") {
+	ScopedMemoryBudget scopedBudget(1000, MemoryBudgetBlock);
+	Allocator allocator(4);
+	auto buffer = allocator.getBuffer<DataRaw>(1000);
+	std::thread releaser([&] {
+		SLEEP_IN_MS(10);
+		buffer = nullptr;
+	});
+	auto second = allocator.getBuffer<DataRaw>(1000);
+	ASSERT(second);
+	releaser.join();
+	ASSERT(!allocator.getBuffer<DataRaw>(1000, std::chrono::microseconds(1000), AllocatorReturnNull));
+}
@@ -0,0 +1,170 @@
+#include "tests.hpp"
+#include "lib_modules/modules.hpp"
+#include "lib_media/common/picture.hpp"
+#include "lib_media/out/file.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+
+using namespace Tests;
+using namespace Modules;
+
+namespace {
+
+bool isAligned(const void *p, size_t alignment) {
+	return ((uintptr_t)p % alignment) == 0;
+}
+
+template<typename PictureType>
+void checkPictureLayout(const Resolution &res, size_t bytesPerPixel) {
+	PictureType pic(res);
+	ASSERT(pic.size() >= pic.getSize());
+	for (size_t i = 0; i < pic.getNumPlanes(); ++i) {
+		ASSERT(isAligned(pic.getPlane(i), DataPicture::PlaneAlignment));
+		ASSERT_EQUALS(0u, pic.getPitch(i) % DataPicture::PlaneAlignment);
+		auto const width = (i == 0 ? res.width : res.width / 2) * bytesPerPixel;
+		ASSERT(pic.getPitch(i) >= width);
+	}
+}
+
+}
+
+unittest("aligned buffer: growth keeps the content") {
+	AlignedBuffer buffer(10);
+	ASSERT(isAligned(buffer.data(), BUFFER_ALIGNMENT_DEFAULT));
+	for (uint8_t i = 0; i < 10; ++i) {
+		buffer.data()[i] = i;
+	}
+	buffer.resize(100000);
+	ASSERT_EQUALS(100000u, buffer.size());
+	ASSERT(isAligned(buffer.data(), BUFFER_ALIGNMENT_DEFAULT));
+	for (uint8_t i = 0; i < 10; ++i) {
+		ASSERT_EQUALS(i, buffer.data()[i]);
+	}
+}
+
+unittest("aligned buffer: shrinking keeps the allocation") {
+	AlignedBuffer buffer(1000, 4096);
+	ASSERT(isAligned(buffer.data(), 4096));
+	ASSERT_EQUALS(4096u, buffer.capacity());
+	auto const data = buffer.data();
+	buffer.resize(10);
+	ASSERT_EQUALS(10u, buffer.size());
+	ASSERT(buffer.data() == data);
+}
+
+unittest("picture: planes and pitches are aligned") {
+	for (auto &res : { Resolution(1920, 1080), Resolution(350, 202), Resolution(16, 16) }) {
+		checkPictureLayout<PictureYUV420P>(res, 1);
+		checkPictureLayout<PictureYUYV422>(res, 2);
+		checkPictureLayout<PictureRGB24>(res, 3);
+	}
+}
+
+unittest("picture: Out::File writes packed planes, without their padding") {
+	auto const res = Resolution(350, 202);
+	auto pic = std::make_shared<PictureYUV420P>(res);
+	for (size_t i = 0; i < pic->getNumPlanes(); ++i) {
+		auto const width = i == 0 ? res.width : res.width / 2, height = i == 0 ? res.height : res.height / 2;
+		memset(pic->getPlane(i), 0xFF, pic->getPitch(i) * height); //padding
+		for (unsigned y = 0; y < height; ++y) {
+			memset(pic->getPlane(i) + y * pic->getPitch(i), (int)i, width);
+		}
+	}
+	const char *path = "out_file_picture.yuv";
+	{
+		auto file = uptr(create<Out::File>(path));
+		file->process(pic);
+	}
+	std::vector<uint8_t> dump(pic->size());
+	auto f = fopen(path, "rb");
+	ASSERT(f);
+	auto const size = fread(dump.data(), 1, dump.size(), f);
+	fclose(f);
+	std::remove(path);
+	ASSERT_EQUALS(pic->getSize(), size);
+	auto const lumaSize = res.width * res.height, chromaSize = lumaSize / 4;
+	for (size_t i = 0; i < size; ++i) {
+		ASSERT_EQUALS(i < lumaSize ? 0 : i < lumaSize + chromaSize ? 1 : 2, (int)dump[i]);
+	}
+}
+
+unittest("huge page arena: aligned buffers, reused after release") {
+	auto arena = std::make_shared<HugePageArena>(HugePageArena::HugePageSize);
+	uint8_t *data = nullptr;
+	{
+		AlignedBuffer buffer(1000, 4096);
+		buffer.setArena(arena);
+		ASSERT(isAligned(buffer.data(), 4096));
+		ASSERT_EQUALS(1000u, buffer.size());
+		data = buffer.data();
+		memset(data, 0xFF, buffer.size());
+		ASSERT_EQUALS(4096u, arena->getStats().usedBytes);
+	}
+	ASSERT_EQUALS(0u, arena->getStats().usedBytes);
+	AlignedBuffer buffer(0);
+	buffer.setArena(arena);
+	buffer.resize(500);
+	ASSERT(buffer.data() == data);
+
+	//larger than a chunk
+	AlignedBuffer big(0);
+	big.setArena(arena);
+	big.resize(3 * HugePageArena::HugePageSize);
+	memset(big.data(), 0, big.size());
+	auto const stats = arena->getStats();
+	size_t numChunks = 0;
+	for (auto n : stats.numChunks) {
+		numChunks += n;
+	}
+	ASSERT_EQUALS(2u, numChunks);
+	ASSERT(stats.mappedBytes >= 4 * HugePageArena::HugePageSize);
+	std::cout << "huge page arena chunks: explicit=" << stats.numChunks[HugePageArena::ExplicitHugePages] << " transparent=" << stats.numChunks[HugePageArena::TransparentHugePages]
+	          << " regular=" << stats.numChunks[HugePageArena::RegularPages] << " heap=" << stats.numChunks[HugePageArena::Heap] << std::endl;
+}
+
+unittest("huge page arena: free neighbours are coalesced, free chunks are unmapped on trim") {
+	auto const chunkSize = HugePageArena::HugePageSize;
+	auto arena = std::make_shared<HugePageArena>(chunkSize);
+	auto a = arena->alloc(chunkSize / 4, 64), b = arena->alloc(chunkSize / 4, 64), c = arena->alloc(chunkSize / 4, 64);
+	auto next = arena->alloc(chunkSize / 2, 64); //doesn't fit: a second chunk
+	arena->free(a, 0);
+	arena->free(b, 0);
+	auto ab = arena->alloc(chunkSize / 2, 64);
+	ASSERT(ab == a);
+	arena->free(ab, 0);
+	arena->free(c, 0);
+	auto whole = arena->alloc(chunkSize, 64);
+	ASSERT(whole == a);
+	arena->free(whole, 0);
+
+	arena->trim();
+	ASSERT_EQUALS(chunkSize, arena->getStats().mappedBytes);
+	arena->free(next, 0);
+	arena->trim();
+	ASSERT_EQUALS(0u, arena->getStats().mappedBytes);
+	ASSERT_EQUALS(0u, arena->getStats().usedBytes);
+}
+
+unittest("huge page arena: as the allocator policy of an output") {
+	auto output = uptr(new OutputDataHugePages<DataPicture>(2));
+	auto pic = output->getBuffer<PictureYUV420P>(0);
+	pic->setResolution(Resolution(1920, 1080));
+	ASSERT(isAligned(pic->getPlane(0), DataPicture::PlaneAlignment));
+	memset(pic->data(), 0, pic->size());
+}
+
+unittest("huge page arena: per-output selection") {
+	auto output = uptr(new OutputPicture(2));
+	auto arena = std::make_shared<HugePageArena>();
+	IOutput *o = output.get();
+	o->setBufferArena(arena);
+	auto pic = DataPicture::create(output.get(), Resolution(1920, 1080), YUV420P);
+	ASSERT(arena->getStats().usedBytes >= pic->size());
+	auto const data = pic->data();
+	pic = nullptr;
+	pic = DataPicture::create(output.get(), Resolution(1920, 1080), YUV420P);
+	ASSERT(pic->data() == data);
+}
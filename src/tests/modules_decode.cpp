@@ -108,7 +108,7 @@ unittest("decode: video simple") {
 		ASSERT_EQUALS(YUV420P, format.format);
 
 		auto const firstPixel = *pic->getPlane(0);
-		auto const lastPixel = *(pic->getPlane(0) + format.res.width * format.res.height - 1);
+		auto const lastPixel = *(pic->getPlane(0) + (format.res.height - 1) * pic->getPitch(0) + format.res.width - 1);
 		ASSERT_EQUALS(0x80, firstPixel);
 		ASSERT_EQUALS(0x80, lastPixel);
 	};
@@ -0,0 +1,64 @@
+#include "tests.hpp"
+#include "lib_modules/modules.hpp"
+#include "lib_media/common/picture.hpp"
+
+
+using namespace Tests;
+using namespace Modules;
+
+namespace {
+
+template<typename DataType>
+class Counter : public ModuleS {
+	public:
+		Counter() : sum(0) {
+			addInput(new Input<DataType>(this));
+		}
+		void process(Data data) override {
+			sum += input_cast<DataType>(data)->getTime();
+		}
+		uint64_t sum;
+};
+
+template<typename Function>
+bool isThrown(Function f) {
+	try {
+		f();
+	} catch (std::exception const&) {
+		return true;
+	}
+	return false;
+}
+
+/* the output may emit any data: its pins are checked one by one */
+typedef OutputDataDefault<DataBase> OutputAnyData;
+
+}
+
+unittest("input: incompatible data types are rejected when connecting") {
+	auto output = uptr(new OutputPicture(1));
+	auto counter = uptr(create<Counter<DataPcm>>());
+	ASSERT(isThrown([&] {
+		ConnectOutputToInput(output.get(), counter->getInput(0), &g_executorSync);
+	}));
+}
+
+unittest("input: data from an output of a base type is checked on push") {
+	auto output = uptr(new OutputAnyData(1));
+	auto counter = uptr(create<Counter<DataPicture>>());
+	ConnectOutputToInput(output.get(), counter->getInput(0), &g_executorSync);
+	output->emit(std::make_shared<PictureYUV420P>(Resolution(16, 16)));
+	ASSERT(isThrown([&] {
+		output->emit(std::make_shared<DataRaw>(0));
+	}));
+}
+
+unittest("input: static connections require convertible data types") {
+	auto output = uptr(new OutputAnyData(1));
+	auto counter = uptr(create<Counter<DataRaw>>());
+	ASSERT(isThrown([&] {
+		ConnectOutputToModulesStatic(output.get(), counter.get());
+	}));
+	auto rawOutput = uptr(new OutputDefault(1));
+	ConnectOutputToModulesStatic(rawOutput.get(), counter.get());
+}
@@ -0,0 +1,37 @@
+#include "tests.hpp"
+#include "lib_modules/modules.hpp"
+
+
+using namespace Tests;
+using namespace Modules;
+
+unittest("metadata: generations are unique and increasing") {
+	MetadataRawAudio first;
+	MetadataRawAudio second(first);
+	ASSERT(first.getGeneration() != 0);
+	ASSERT(second.getGeneration() > first.getGeneration());
+
+	//an assigned object has a new content: pins must not take it for the metadata they saw
+	auto const generation = first.getGeneration();
+	first = second;
+	ASSERT(first.getGeneration() != generation);
+	ASSERT(first.getGeneration() > second.getGeneration());
+}
+
+unittest("metadata: attached once, then compared by generation") {
+	MetadataCap pin(new MetadataRawAudio);
+	auto const metadata = pin.getMetadata().get();
+	auto data = std::make_shared<DataRaw>(0);
+	ASSERT(pin.updateMetadata(data));
+	ASSERT(data->getMetadataPtr() == metadata);
+	auto const useCount = data->getMetadata().use_count();
+	ASSERT(!pin.updateMetadata(data));
+	ASSERT_EQUALS(useCount, data->getMetadata().use_count());
+
+	//new metadata carried by the data
+	auto other = std::make_shared<DataRaw>(0);
+	other->setMetadata(std::make_shared<MetadataRawAudio>());
+	ASSERT(pin.updateMetadata(other));
+	ASSERT(pin.getMetadata() == other->getMetadata());
+	ASSERT(!pin.updateMetadata(other));
+}
@@ -0,0 +1,296 @@
+#include "tests.hpp"
+#include "lib_modules/modules.hpp"
+#include "lib_media/common/picture.hpp"
+#include "lib_modules/utils/pipeline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+
+using namespace Tests;
+using namespace Modules;
+using namespace Pipelines;
+
+namespace {
+
+void allocationLatencyTest(const std::string &name, Signals::QueueType freeListType) {
+	const int numBuffers = 100000;
+	const int numRecyclers = 3;
+	PacketAllocator<DataRaw> allocator(64, freeListType);
+	Signals::QueueMPMC<std::shared_ptr<DataRaw>> toRecycle(64);
+	std::vector<std::thread> recyclers;
+	for (int i = 0; i < numRecyclers; ++i) {
+		recyclers.push_back(std::thread([&] {
+			while (toRecycle.pop()) {
+			}
+		}));
+	}
+
+	std::vector<int64_t> latenciesInNs(numBuffers);
+	for (int i = 0; i < numBuffers; ++i) {
+		auto const start = std::chrono::high_resolution_clock::now();
+		auto buffer = allocator.getBuffer<DataRaw>(1000);
+		latenciesInNs[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+		toRecycle.push(buffer);
+	}
+	for (int i = 0; i < numRecyclers; ++i) {
+		toRecycle.push(nullptr);
+	}
+	for (auto &t : recyclers) {
+		t.join();
+	}
+
+	std::sort(latenciesInNs.begin(), latenciesInNs.end());
+	auto percentile = [&](double p) {
+		return latenciesInNs[std::min<size_t>((size_t)(p * numBuffers), numBuffers - 1)];
+	};
+	std::cout << name << ": p50=" << percentile(0.50) << "ns p99=" << percentile(0.99) << "ns p99.9=" << percentile(0.999) << "ns max=" << latenciesInNs.back() << "ns" << std::endl;
+}
+
+/* a freshly allocated frame written once, as a decoder would do */
+template<typename Buffer>
+double frameAllocationBandwidthInGBps(size_t frameSize, int numFrames) {
+	auto const start = std::chrono::high_resolution_clock::now();
+	uint64_t checksum = 0;
+	for (int i = 0; i < numFrames; ++i) {
+		Buffer buffer(frameSize);
+		memset(buffer.data(), i, frameSize);
+		checksum += buffer.data()[frameSize - 1];
+	}
+	auto const durationInUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+	ASSERT(checksum > 0);
+	return (double)frameSize * numFrames / std::max<int64_t>(durationInUs, 1) / 1000.0;
+}
+
+void frameAllocationTest(const std::string &name, const Resolution &res, int numFrames) {
+	auto const frameSize = PictureFormat::getSize(res, YUV420P);
+	auto const vectorBandwidth = frameAllocationBandwidthInGBps<std::vector<uint8_t>>(frameSize, numFrames);
+	auto const alignedBandwidth = frameAllocationBandwidthInGBps<AlignedBuffer>(frameSize, numFrames);
+	std::cout << name << ": std::vector " << vectorBandwidth << " GB/s, AlignedBuffer " << alignedBandwidth << " GB/s" << std::endl;
+}
+
+
+/* sums the times of the data it receives */
+class TimeSum : public ModuleS {
+	public:
+		TimeSum() : sum(0) {
+			addInput(new Input<DataRaw>(this));
+		}
+		void process(Data data) override {
+			sum += data->getTime();
+		}
+		uint64_t sum;
+};
+
+template<typename OutputType>
+double emitTimeInNs(const std::string &name, int numData) {
+	auto output = uptr(new OutputType(ALLOC_NUM_BLOCKS_DEFAULT));
+	auto sink = uptr(create<TimeSum>());
+	ConnectOutputToInput(output.get(), sink->getInput(0), &g_executorSync);
+	auto data = std::make_shared<DataRaw>(0);
+	auto const start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < numData; ++i) {
+		data->setTime(i);
+		output->emit(data);
+	}
+	auto const timeInNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count() / (double)numData;
+	ASSERT_EQUALS((uint64_t)numData * (numData - 1) / 2, sink->sum);
+	std::cout << name << ": " << timeInNs << " ns per data" << std::endl;
+	return timeInNs;
+}
+
+
+class BatchingSource : public ModuleS {
+	public:
+		BatchingSource(int numPackets, size_t batchSize) : numPackets(numPackets), batchSize(batchSize) {
+			output = addOutput<OutputDefault>();
+		}
+		void process(Data) override {
+			std::vector<Data> batch;
+			for (int i = 0; i < numPackets; ++i) {
+				auto out = output->getBuffer(0);
+				out->setTime(i);
+				batch.push_back(out);
+				if (batch.size() == batchSize || i + 1 == numPackets) {
+					if (batchSize == 1)
+						output->emit(batch[0]);
+					else
+						output->emitBatch(batch);
+					batch.clear();
+				}
+			}
+		}
+
+	private:
+		int const numPackets;
+		size_t const batchSize;
+		OutputDefault *output;
+};
+
+std::atomic<int> g_numCountedPackets(0);
+
+class CountingSink : public ModuleS {
+	public:
+		CountingSink() {
+			addInput(new Input<DataBase>(this));
+		}
+		void process(Data) override {
+			g_numCountedPackets++;
+		}
+};
+
+class CountingSinkBatch : public ModuleSBatch {
+	public:
+		CountingSinkBatch() {
+			addInput(new Input<DataBase>(this));
+		}
+		void process(span<Data> batch) override {
+			g_numCountedPackets += (int)batch.size();
+		}
+};
+
+template<typename SinkType>
+void pipelineThroughputTest(const std::string &name, size_t batchSize) {
+	const int numPackets = 20000;
+	g_numCountedPackets = 0;
+	Pipeline p;
+	auto source = p.addModule<BatchingSource>(numPackets, batchSize);
+	auto sink = p.addModule<SinkType>();
+	p.connect(source, 0, sink, 0);
+	auto const start = std::chrono::high_resolution_clock::now();
+	p.start();
+	p.waitForCompletion();
+	auto const durationInUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+	std::cout << name << ": " << (int64_t)(numPackets * 1000000.0 / std::max<int64_t>(durationInUs, 1)) << " packets/s" << std::endl;
+	ASSERT_EQUALS(numPackets, g_numCountedPackets);
+}
+
+
+int64_t steadyTimeInUs() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* time is the emission date: the sink computes the end-to-end latency */
+class StampingSource : public ModuleS {
+	public:
+		StampingSource(int numPackets) : numPackets(numPackets) {
+			output = addOutput<OutputDefault>();
+		}
+		void process(Data) override {
+			for (int i = 0; i < numPackets; ++i) {
+				auto out = output->getBuffer(0);
+				out->setTime(steadyTimeInUs());
+				output->emit(out);
+			}
+		}
+
+	private:
+		int const numPackets;
+		OutputDefault *output;
+};
+
+class Forwarder : public ModuleS {
+	public:
+		Forwarder() {
+			addInput(new Input<DataBase>(this));
+			output = addOutput<OutputDefault>();
+		}
+		void process(Data data) override {
+			output->emit(data);
+		}
+
+	private:
+		OutputDefault *output;
+};
+
+std::atomic<int64_t> g_sumOfLatenciesInUs(0), g_peakLatencyInUs(0);
+
+class LatencyMeter : public ModuleS {
+	public:
+		LatencyMeter() {
+			addInput(new Input<DataBase>(this));
+		}
+		void process(Data data) override {
+			auto const latency = steadyTimeInUs() - (int64_t)data->getTime();
+			g_sumOfLatenciesInUs += latency;
+			if (latency > g_peakLatencyInUs)
+				g_peakLatencyInUs = latency;
+			g_numCountedPackets++;
+		}
+};
+
+void pipelineFusionTest(const std::string &name, bool fusion) {
+	const int numPackets = 20000, numRelays = 3;
+	g_numCountedPackets = 0;
+	g_sumOfLatenciesInUs = g_peakLatencyInUs = 0;
+	Pipeline p;
+	p.setAutoFusion(fusion);
+	IModule *prev = p.addModule<StampingSource>(numPackets);
+	for (int i = 0; i < numRelays; ++i) {
+		auto relay = p.addModule<Forwarder>();
+		p.connect(prev, 0, relay, 0);
+		prev = relay;
+	}
+	p.connect(prev, 0, p.addModule<LatencyMeter>(), 0);
+	auto const startCpu = std::clock();
+	auto const start = steadyTimeInUs();
+	p.start();
+	p.waitForCompletion();
+	auto const durationInUs = steadyTimeInUs() - start;
+	auto const cpuInMs = (std::clock() - startCpu) * 1000.0 / CLOCKS_PER_SEC;
+	std::cout << name << ": " << durationInUs / 1000 << " ms, " << cpuInMs << " ms CPU, latency: "
+	          << g_sumOfLatenciesInUs / numPackets << " us average, " << g_peakLatencyInUs << " us max" << std::endl;
+	ASSERT_EQUALS(numPackets, g_numCountedPackets);
+}
+
+}
+
+unittest("allocator: getBuffer() latency percentiles with multi-threaded recycle") {
+	allocationLatencyTest("locked free list   ", Signals::QueueLocked);
+	allocationLatencyTest("lock-free free list", Signals::QueueLockFreeMPMC);
+}
+
+unittest("picture: 1080p and 4K frame allocation bandwidth") {
+	frameAllocationTest("1080p", Resolution(1920, 1080), 100);
+	frameAllocationTest("4K   ", Resolution(3840, 2160), 25);
+}
+
+unittest("input: per data overhead of the data type checks") {
+	const int numData = 1000000;
+	auto const checked = emitTimeInNs<OutputDataDefault<DataBase>>("checked on push  ", numData); //any data: checked per pin
+	auto const connectTime = emitTimeInNs<OutputDefault>("checked on connect", numData);
+	std::cout << "difference: " << checked - connectTime << " ns per data" << std::endl;
+}
+
+unittest("metadata: per data cost of emitting small packets") {
+	const int numData = 1000000;
+	auto output = uptr(new OutputDefault(ALLOC_NUM_BLOCKS_DEFAULT, new MetadataRawAudio));
+	uint64_t sum = 0;
+	output->getSignal().connect([&](Data data) {
+		sum += data->getTime();
+	});
+	auto const start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < numData; ++i) {
+		auto data = output->getBuffer(64);
+		data->setTime(i);
+		output->emit(data);
+	}
+	auto const timeInNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count() / (double)numData;
+	ASSERT_EQUALS((uint64_t)numData * (numData - 1) / 2, sum);
+	std::cout << "getBuffer() and emit() of small packets: " << timeInNs << " ns per data" << std::endl;
+}
+
+unittest("pipeline: packets/s with batching off and on") {
+	pipelineThroughputTest<CountingSink>     ("batching off         ", 1);
+	pipelineThroughputTest<CountingSinkBatch>("batching on (8 items)", 8);
+}
+
+unittest("pipeline: latency and CPU with module fusion off and on") {
+	pipelineFusionTest("fusion off", false);
+	pipelineFusionTest("fusion on ", true);
+}
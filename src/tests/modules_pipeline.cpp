@@ -3,6 +3,14 @@
 #include "lib_media/mux/gpac_mux_mp4.hpp"
 #include "lib_media/out/null.hpp"
 #include "lib_modules/utils/pipeline.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
 
 
 using namespace Tests;
@@ -40,6 +48,440 @@ private:
 	uint64_t numCalls = 0;
 };
 
+class PacketSource : public ModuleS {
+public:
+	PacketSource(int numPackets, size_t batchSize) : numPackets(numPackets), batchSize(batchSize) {
+		output = addOutput<OutputDefault>();
+	}
+	void process(Data) override {
+		std::vector<Data> batch;
+		for (int i = 0; i < numPackets; ++i) {
+			auto out = output->getBuffer(0);
+			out->setTime(i);
+			batch.push_back(out);
+			if (batch.size() == batchSize || i + 1 == numPackets) {
+				if (batchSize == 1)
+					output->emit(batch[0]);
+				else
+					output->emitBatch(batch);
+				batch.clear();
+			}
+		}
+	}
+
+private:
+	int const numPackets;
+	size_t const batchSize;
+	OutputDefault *output;
+};
+
+std::atomic<int> g_numReceivedPackets(0);
+
+class PacketSink : public ModuleS {
+public:
+	PacketSink() {
+		addInput(new Input<DataBase>(this));
+	}
+	void process(Data) override {
+		g_numReceivedPackets++;
+	}
+};
+
+class PacketSinkBatch : public ModuleSBatch {
+public:
+	PacketSinkBatch() {
+		addInput(new Input<DataBase>(this));
+	}
+	void process(span<Data> batch) override {
+		g_numReceivedPackets += (int)batch.size();
+	}
+};
+
+class FailingSinkBatch : public ModuleSBatch {
+public:
+	FailingSinkBatch() {
+		addInput(new Input<DataBase>(this));
+	}
+	void process(span<Data> batch) override {
+		g_numReceivedPackets += (int)batch.size();
+		if (fail) {
+			fail = false;
+			throw error("batch failure");
+		}
+	}
+
+private:
+	bool fail = true;
+};
+
+unittest("pipeline: a batch sink doesn't keep the batch, even when processing fails") {
+	g_numReceivedPackets = 0;
+	auto output = uptr(new OutputDefault(4));
+	auto sink = uptr(create<FailingSinkBatch>());
+	IModule *module = sink.get();
+	sink->getInput(0)->push(output->getBuffer(0));
+	sink->getInput(0)->push(output->getBuffer(0));
+	bool thrown = false;
+	try {
+		module->process();
+	} catch (std::exception const& e) {
+		std::cerr << "Expected error: " << e.what() << std::endl;
+		thrown = true;
+	}
+	ASSERT(thrown);
+	ASSERT_EQUALS(2, g_numReceivedPackets);
+	ASSERT_EQUALS(0u, output->getAllocatorStats().numBlocksInFlight);
+	sink->getInput(0)->push(output->getBuffer(0));
+	module->process();
+	ASSERT_EQUALS(3, g_numReceivedPackets);
+	ASSERT_EQUALS(0u, output->getAllocatorStats().numBlocksInFlight);
+}
+
+unittest("pipeline: batched emission") {
+	const int numPackets = 1000;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	auto source = p.addModule<PacketSource>(numPackets, 8);
+	auto sink = p.addModule<PacketSinkBatch>();
+	p.connect(source, 0, sink, 0);
+	p.start();
+	p.waitForCompletion();
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+}
+
+unittest("pipeline: allocator stats") {
+	const int numPackets = 1000;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	p.setAllocatorStatsPeriod(std::chrono::milliseconds(1));
+	auto source = p.addModule<PacketSource>(numPackets, 1);
+	auto sink = p.addModule<PacketSink>();
+	p.connect(source, 0, sink, 0);
+	p.start();
+	p.waitForCompletion();
+	auto const stats = source->getOutput(0)->getAllocatorStats();
+	ASSERT_EQUALS(ALLOC_NUM_BLOCKS_DEFAULT, stats.numBlocks);
+	ASSERT_EQUALS(0u, stats.numBlocksInFlight);
+	ASSERT(stats.highWaterMark >= 1 && stats.highWaterMark <= ALLOC_NUM_BLOCKS_DEFAULT);
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+}
+
+int64_t nowInUs() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::thread::id g_sourceThread, g_sinkThread;
+
+/* time is the emission date: the sinks compute the end-to-end latency */
+class TimedPacketSource : public ModuleS {
+public:
+	TimedPacketSource(int numPackets) : numPackets(numPackets) {
+		output = addOutput<OutputDefault>();
+	}
+	void process(Data) override {
+		g_sourceThread = std::this_thread::get_id();
+		for (int i = 0; i < numPackets; ++i) {
+			auto out = output->getBuffer(0);
+			out->setTime(nowInUs());
+			out->setIngestTime(getWallClockInUs());
+			output->emit(out);
+		}
+	}
+
+private:
+	int const numPackets;
+	OutputDefault *output;
+};
+
+/* forwards the data: doesn't wait for a free block */
+class PacketRelay : public ModuleS {
+public:
+	PacketRelay() {
+		addInput(new Input<DataBase>(this));
+		output = addOutput<OutputDefault>();
+	}
+	void process(Data data) override {
+		output->emit(data);
+	}
+
+private:
+	OutputDefault *output;
+};
+
+std::atomic<int64_t> g_totalLatencyInUs(0), g_maxLatencyInUs(0);
+
+class LatencySink : public ModuleS {
+public:
+	LatencySink() {
+		addInput(new Input<DataBase>(this));
+	}
+	void process(Data data) override {
+		g_sinkThread = std::this_thread::get_id();
+		auto const latency = nowInUs() - (int64_t)data->getTime();
+		g_totalLatencyInUs += latency;
+		if (latency > g_maxLatencyInUs)
+			g_maxLatencyInUs = latency;
+		g_numReceivedPackets++;
+	}
+};
+
+unittest("pipeline: auto fusion of a linear chain") {
+	const int numPackets = 1000, numRelays = 3;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	p.setAutoFusion(true);
+	IModule *prev = p.addModule<TimedPacketSource>(numPackets);
+	for (int i = 0; i < numRelays; ++i) {
+		auto relay = p.addModule<PacketRelay>();
+		p.connect(prev, 0, relay, 0);
+		prev = relay;
+	}
+	p.connect(prev, 0, p.addModule<LatencySink>(), 0);
+	p.start();
+	p.waitForCompletion();
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+	ASSERT(g_sourceThread == g_sinkThread);
+}
+
+unittest("pipeline: fused modules run in the upstream module thread") {
+	const int numPackets = 100;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	auto source = p.addModule<TimedPacketSource>(numPackets);
+	auto relay = p.addModule<PacketRelay>();
+	auto sink = p.addModule<LatencySink>();
+	p.connect(source, 0, relay, 0);
+	p.connect(relay, 0, sink, 0);
+	p.fuse(relay);
+	p.fuse(sink);
+	p.start();
+	p.waitForCompletion();
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+	ASSERT(g_sourceThread == g_sinkThread);
+}
+
+unittest("pipeline: fused module with a dedicated thread policy") {
+	const int numPackets = 100;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	auto source = p.addModule<TimedPacketSource>(numPackets);
+	auto sink = p.addModuleWithPolicy<LatencySink>(ExecutionPolicy(ExecutionPolicy::DedicatedThread));
+	p.connect(source, 0, sink, 0);
+	p.fuse(sink);
+	p.start();
+	p.waitForCompletion();
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+	ASSERT(g_sourceThread == g_sinkThread);
+}
+
+unittest("pipeline: fusion hint on a module with several connected inputs") {
+	bool thrown = false;
+	try {
+		Pipeline p;
+		auto source = p.addModule<PacketSource>(1, 1);
+		auto dualInput = p.addModule<DualInput>();
+		p.connect(source, 0, dualInput, 0);
+		p.connect(source, 0, dualInput, 1);
+		p.fuse(dualInput);
+		p.start();
+	} catch (std::runtime_error const& /*e*/) {
+		thrown = true;
+	}
+	ASSERT(thrown);
+}
+
+void pipelinePolicyTest(const ExecutionPolicy &policy) {
+	const int numPackets = 100;
+	g_numReceivedPackets = 0;
+	Pipeline p(false, policy);
+	auto source = p.addModule<TimedPacketSource>(numPackets);
+	auto relay = p.addModule<PacketRelay>();
+	auto sink = p.addModule<LatencySink>();
+	p.connect(source, 0, relay, 0);
+	p.connect(relay, 0, sink, 0);
+	p.start();
+	p.waitForCompletion();
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+}
+
+unittest("pipeline: execution policies") {
+	pipelinePolicyTest(ExecutionPolicy(ExecutionPolicy::StrandedPool));
+	pipelinePolicyTest(ExecutionPolicy(ExecutionPolicy::StrandedPool, createThreadPool(3)));
+	pipelinePolicyTest(ExecutionPolicy(ExecutionPolicy::StrandedPool, createThreadPool(2, { 0, -1 })));
+	pipelinePolicyTest(ExecutionPolicy(ExecutionPolicy::DedicatedThread));
+	pipelinePolicyTest(ExecutionPolicy(ExecutionPolicy::DedicatedThread, nullptr, 0));
+	pipelinePolicyTest(ExecutionPolicy(ExecutionPolicy::Synchronous));
+}
+
+unittest("pipeline: per-module execution policy") {
+	const int numPackets = 100;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	auto source = p.addModuleWithPolicy<TimedPacketSource>(ExecutionPolicy(ExecutionPolicy::DedicatedThread), numPackets);
+	auto sink = p.addModuleWithPolicy<LatencySink>(ExecutionPolicy(ExecutionPolicy::StrandedPool, createThreadPool(1)));
+	p.connect(source, 0, sink, 0);
+	p.start();
+	p.waitForCompletion();
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+	ASSERT(g_sourceThread != g_sinkThread);
+}
+
+unittest("pipeline: synchronous execution runs in start()") {
+	const int numPackets = 100;
+	g_numReceivedPackets = 0;
+	Pipeline p(false, ExecutionPolicy(ExecutionPolicy::Synchronous));
+	auto source = p.addModule<TimedPacketSource>(numPackets);
+	auto sink = p.addModule<LatencySink>();
+	p.connect(source, 0, sink, 0);
+	p.start();
+	ASSERT_EQUALS(numPackets, g_numReceivedPackets);
+	ASSERT(std::this_thread::get_id() == g_sinkThread);
+	p.waitForCompletion();
+}
+
+unittest("pipeline: module stats") {
+	const int numPackets = 100;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	auto source = p.addModule<TimedPacketSource>(numPackets);
+	auto relay = p.addModule<PacketRelay>();
+	auto sink = p.addModule<LatencySink>();
+	p.connect(source, 0, relay, 0);
+	p.connect(relay, 0, sink, 0);
+	p.start();
+	p.waitForCompletion();
+	auto const stats = p.getStats();
+	ASSERT_EQUALS(3u, stats.size());
+	ASSERT_EQUALS((uint64_t)numPackets, stats[0].numPacketsOut);
+	ASSERT_EQUALS((uint64_t)numPackets, stats[1].numPacketsIn);
+	ASSERT_EQUALS((uint64_t)numPackets, stats[1].numPacketsOut);
+	ASSERT_EQUALS((uint64_t)numPackets, stats[2].numPacketsIn);
+	ASSERT_EQUALS(stats[1].numBytesIn, stats[1].numBytesOut);
+	for (auto &s : stats) {
+		ASSERT_EQUALS(0u, s.queueDepth);
+	}
+	ASSERT(stats[1].maxQueueDepth >= 1);
+	ASSERT(stats[1].name.find("PacketRelay") != std::string::npos);
+	ASSERT(stats[0].processTimeInUs > 0);
+}
+
+unittest("pipeline: end-to-end latency at the sinks") {
+	const int numPackets = 100;
+	g_numReceivedPackets = 0;
+	Pipeline p;
+	auto source = p.addModule<TimedPacketSource>(numPackets);
+	auto relay = p.addModule<PacketRelay>();
+	auto sink = p.addModule<LatencySink>();
+	auto untimedSource = p.addModule<PacketSource>(1, 1);
+	auto untimedSink = p.addModule<LatencySink>();
+	p.connect(source, 0, relay, 0);
+	p.connect(relay, 0, sink, 0);
+	p.connect(untimedSource, 0, untimedSink, 0);
+	p.start();
+	p.waitForCompletion();
+	auto const stats = p.getStats();
+	ASSERT(stats[0].latencies.empty());
+	ASSERT(stats[1].latencies.empty());
+	ASSERT_EQUALS(1u, stats[2].latencies.size());
+	auto const &latency = stats[2].latencies[0];
+	ASSERT_EQUALS((uint64_t)numPackets, latency.numSamples);
+	ASSERT(latency.p50InUs <= latency.p99InUs);
+	ASSERT(latency.p99InUs <= latency.maxInUs);
+	ASSERT(latency.maxInUs <= latency.totalInUs);
+	ASSERT_EQUALS(1u, stats[4].latencies.size());
+	ASSERT_EQUALS(0u, stats[4].latencies[0].numSamples);
+}
+
+std::string readFile(const std::string &path) {
+	std::ifstream file(path);
+	std::stringstream content;
+	content << file.rdbuf();
+	return content.str();
+}
+
+void pipelineStatsDumpTest(const std::string &path, StatsFormat format) {
+	const int numPackets = 100;
+	std::remove(path.c_str());
+	{
+		Pipeline p;
+		p.setStatsDump(path, std::chrono::milliseconds(1), format);
+		auto source = p.addModule<TimedPacketSource>(numPackets);
+		auto sink = p.addModule<LatencySink>();
+		p.connect(source, 0, sink, 0);
+		p.start();
+		p.waitForCompletion();
+	}
+}
+
+unittest("pipeline: stats dump as JSON lines") {
+	pipelineStatsDumpTest("pipeline_stats.json", StatsJsonLines);
+	auto const content = readFile("pipeline_stats.json");
+	ASSERT(content.find("{\"timeInMs\":") == 0);
+	ASSERT(content.find("\"packetsIn\":100,") != std::string::npos);
+	ASSERT(content.find("\"latencies\":[{\"input\":0,\"samples\":100,") != std::string::npos);
+	ASSERT_EQUALS('\n', content.back());
+	std::remove("pipeline_stats.json");
+}
+
+unittest("pipeline: stats dump in Prometheus text format") {
+	pipelineStatsDumpTest("pipeline_stats.prom", StatsPrometheus);
+	auto const content = readFile("pipeline_stats.prom");
+	ASSERT(content.find("# TYPE signals_module_packets_in_total counter\n") == 0);
+	ASSERT(content.find("signals_module_packets_in_total{index=\"1\"") != std::string::npos);
+	ASSERT(content.find("} 100\n") != std::string::npos);
+	ASSERT(content.find("signals_sink_latency_us{index=\"1\",module=\"") != std::string::npos);
+	ASSERT(content.find(",input=\"0\",quantile=\"0.99\"} ") != std::string::npos);
+	ASSERT(content.find("signals_sink_latency_us_count{") != std::string::npos);
+	std::remove("pipeline_stats.prom");
+}
+
+unittest("pipeline: Chrome trace events") {
+	const int numPackets = 10;
+	std::remove("pipeline_trace.json");
+	Tracing::start("pipeline_trace.json");
+	{
+		Pipeline p;
+		auto source = p.addModule<TimedPacketSource>(numPackets);
+		auto relay = p.addModule<PacketRelay>();
+		auto sink = p.addModule<LatencySink>();
+		p.connect(source, 0, relay, 0);
+		p.connect(relay, 0, sink, 0);
+		p.start();
+		p.waitForCompletion();
+	}
+	Tracing::stop();
+	ASSERT(!Tracing::isEnabled());
+	auto const content = readFile("pipeline_trace.json");
+	ASSERT(content.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[") == 0);
+	ASSERT(content.find("PacketRelay>\",\"cat\":\"process\",\"ph\":\"X\"") != std::string::npos);
+	ASSERT(content.find("LatencySink>\",\"cat\":\"process\",\"ph\":\"X\"") != std::string::npos);
+	ASSERT(content.find("\"ph\":\"s\",\"id\":1,") != std::string::npos);
+	ASSERT(content.find("\"ph\":\"f\",\"bp\":\"e\",\"id\":1,") != std::string::npos);
+	ASSERT(content.find("\"traceId\":" + std::to_string(numPackets) + "}") != std::string::npos);
+	ASSERT(content.find("\"numDroppedEvents\":0}") != std::string::npos);
+	std::remove("pipeline_trace.json");
+}
+
+unittest("pipeline: data is not tagged when tracing is disabled") {
+	auto output = uptr(new OutputDefault(1));
+	auto data = output->getBuffer(0);
+	output->emit(data);
+	ASSERT_EQUALS(0u, data->getTraceId());
+}
+
+unittest("pipeline: shared data keeps the first trace id") {
+	auto data = std::make_shared<DataRaw>(0);
+	uint64_t traceIds[2];
+	std::thread tagger([&] {
+		traceIds[0] = data->initTraceId(1);
+	});
+	traceIds[1] = data->initTraceId(2);
+	tagger.join();
+	ASSERT_EQUALS(data->getTraceId(), traceIds[0]);
+	ASSERT_EQUALS(data->getTraceId(), traceIds[1]);
+	ASSERT_EQUALS(data->getTraceId(), data->initTraceId(3));
+}
+
 unittest("pipeline: empty") {
 	{
 		Pipeline p;
@@ -47,3 +47,12 @@ unittest("print packets size from file: File -> Out::Print") {
 
 	f->process(nullptr);
 }
+
+unittest("print packets size from file with a static connection: File -> Out::Print") {
+	auto f = uptr(create<In::File>("data/beepbop.mp4"));
+	auto p = uptr(create<Out::Print>(std::cout));
+
+	ConnectModulesStatic(f.get(), p.get());
+
+	f->process(nullptr);
+}
@@ -13,7 +13,8 @@ $(BIN)/$(ProjectName)/utils_%.o: CFLAGS+=-DUNIT
 #---------------------------------------------------------------
 EXE_UTILS_OBJS:=\
  	$(OUTDIR)/utils.o\
- 	$(TEST_COMMON_OBJ)
+ 	$(TEST_COMMON_OBJ)\
+ 	$(UTILS_OBJS)
 DEPS+=$(EXE_UTILS_OBJS:%.o=%.deps)
 
 TARGETS+=$(OUTDIR)/utils.exe
@@ -1,6 +1,8 @@
 #include "tests.hpp"
 #include "lib_signals/signals.hpp"
+#include <atomic>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 using namespace Tests;
@@ -65,5 +67,241 @@ unittest("as many results as emit() calls, results arriving in wrong order") {
 	ASSERT((*res)[0] == 27);
 	ASSERT((*res)[1] == 1789);
 }
+unittest("emit from several threads while connecting and disconnecting") {
+	ExecutorSync<void(int)> executor;
+	Signal<void(int), ResultVector<void>> sig(executor);
+	std::atomic<int> numCalls(0);
+	auto onEmit = [&](int) {
+		numCalls++;
+	};
+	sig.connect(onEmit);
+	std::atomic<bool> done(false);
+	std::vector<std::thread> emitters;
+	for (int i = 0; i < 4; ++i) {
+		emitters.push_back(std::thread([&]() {
+			for (int j = 0; j < 1000; ++j) {
+				auto const numReceivers = sig.emit(j);
+				ASSERT(numReceivers >= 1);
+			}
+		}));
+	}
+	std::thread connector([&]() {
+		while (!done) {
+			auto const id = sig.connect(onEmit);
+			bool res = sig.disconnect(id);
+			ASSERT(res);
+		}
+	});
+	for (auto &t : emitters) {
+		t.join();
+	}
+	done = true;
+	connector.join();
+	ASSERT(numCalls >= 4 * 1000);
 }
 
+unittest("thread pool: executes all the pending tasks before stopping") {
+	std::atomic<int> numCalls(0);
+	{
+		ThreadPool pool(4);
+		for (int i = 0; i < 100; ++i) {
+			pool.post([&]() {
+				numCalls++;
+			});
+		}
+		pool.WaitForCompletion();
+		uint64_t numExecuted = 0;
+		for (auto &s : pool.getStats()) {
+			numExecuted += s.numExecuted;
+			ASSERT(s.queueLength == 0);
+		}
+		ASSERT(numExecuted == 100);
+	}
+	ASSERT(numCalls == 100);
+}
+
+unittest("thread pool: tasks posted from a worker are executed LIFO") {
+	std::vector<int> order;
+	std::atomic_bool done(false);
+	ThreadPool pool(2);
+	pool.post([&]() {
+		//keeps the other worker busy: it would steal
+		while (!done) {
+			std::this_thread::yield();
+		}
+	});
+	pool.post([&]() {
+		for (int i = 0; i < 3; ++i) {
+			pool.post([&order, &done, i]() {
+				order.push_back(i);
+				if (i == 0)
+					done = true;
+			});
+		}
+	});
+	pool.WaitForCompletion();
+	ASSERT(order == std::vector<int>({ 2, 1, 0 }));
+}
+
+unittest("executor thread: tasks posted from the executor thread keep their order") {
+	std::vector<int> order;
+	{
+		ExecutorThread<void(int)> executor;
+		executor.post([&](int) {
+			for (int i = 0; i < 3; ++i) {
+				executor.post([&order](int val) {
+					order.push_back(val);
+				}, i);
+			}
+		}, 0);
+	} //runs the pending tasks
+	ASSERT(order == std::vector<int>({ 0, 1, 2 }));
+}
+
+unittest("thread pool: idle workers steal tasks") {
+	std::atomic<int> numCalls(0);
+	ThreadPool pool(4);
+	pool.post([&]() {
+		for (int i = 0; i < 8; ++i) {
+			pool.post([&]() {
+				Util::sleepInMs(5);
+				numCalls++;
+			});
+		}
+		Util::sleepInMs(50);
+	});
+	pool.WaitForCompletion();
+	ASSERT(numCalls == 8);
+	uint64_t numSteals = 0;
+	for (auto &s : pool.getStats()) {
+		numSteals += s.numSteals;
+	}
+	ASSERT(numSteals > 0);
+}
+
+unittest("thread pool executor: results and fire-and-forget") {
+	auto pool = std::make_shared<ThreadPool>(2);
+	ExecutorThreadPool<int(int)> executor(pool);
+	Signal<int(int)> sig(executor);
+	sig.connect(Util::dummy);
+	sig.emit(27);
+	sig.emit(1789);
+	auto res = sig.results();
+	ASSERT(res->size() == 2);
+	ASSERT((*res)[0] == 27);
+	ASSERT((*res)[1] == 1789);
+
+	std::atomic<int> numCalls(0);
+	ExecutorThreadPool<void(int)> executorVoid(pool);
+	Signal<void(int)> sigVoid(executorVoid);
+	sigVoid.connect([&](int) {
+		numCalls++;
+	});
+	for (int i = 0; i < 10; ++i) {
+		sigVoid.emit(i);
+	}
+	pool->WaitForCompletion();
+	ASSERT(numCalls == 10);
+}
+
+unittest("bounded executor: concurrency limit") {
+	std::atomic<int> numCalls(0), numRunning(0), maxRunning(0);
+	{
+		ExecutorBounded<void(int)> executor(2);
+		Signal<void(int)> sig(executor);
+		sig.connect([&](int ms) {
+			auto const n = ++numRunning;
+			int max = maxRunning;
+			while (n > max && !maxRunning.compare_exchange_weak(max, n)) {
+			}
+			Util::sleepInMs(ms);
+			numRunning--;
+			numCalls++;
+		});
+		for (int i = 0; i < 10; ++i) {
+			sig.emit(10);
+		}
+	}
+	ASSERT(numCalls == 10);
+	ASSERT(maxRunning <= 2);
+}
+
+unittest("bounded executor: emit blocks when the queue is full") {
+	std::atomic<bool> release(false), lastEmitted(false);
+	ExecutorBounded<void(int)> executor(1, 1);
+	Signal<void(int)> sig(executor);
+	sig.connect([&](int) {
+		while (!release) {
+			Util::sleepInMs(1);
+		}
+	});
+	sig.emit(0);
+	sig.emit(1);
+	std::thread emitter([&]() {
+		sig.emit(2);
+		lastEmitted = true;
+	});
+	Util::sleepInMs(50);
+	ASSERT(!lastEmitted);
+	release = true;
+	emitter.join();
+	ASSERT(lastEmitted);
+}
+
+unittest("bounded executor: emitting from a slot on a full queue doesn't deadlock") {
+	std::atomic<int> numCalls(0);
+	{
+		auto pool = std::make_shared<ThreadPool>(1);
+		ExecutorBounded<void(int)> executor(1, 1, pool);
+		Signal<void(int)> sig(executor);
+		sig.connect([&](int depth) {
+			numCalls++;
+			if (depth == 0) {
+				for (int i = 0; i < 4; ++i) {
+					sig.emit(1);
+				}
+			}
+		});
+		sig.emit(0);
+		for (int i = 0; i < 1000 && numCalls < 5; ++i) {
+			Util::sleepInMs(1); //the signal must outlive the emits from its slot
+		}
+	}
+	ASSERT(numCalls == 5);
+}
+
+unittest("bounded executor: reference arguments are copied") {
+	std::string received;
+	{
+		ExecutorBounded<void(const std::string&)> executor;
+		Signal<void(const std::string&)> sig(executor);
+		sig.connect([&](const std::string &s) {
+			Util::sleepInMs(50);
+			received = s;
+		});
+		sig.emit(std::string("emitted from a temporary"));
+	}
+	ASSERT_EQUALS("emitted from a temporary", received);
+}
+
+unittest("bounded executor: destroyed from one of its tasks") {
+	std::atomic<int> numCalls(0);
+	std::atomic_bool queued(false);
+	auto executor = new ExecutorBounded<void(int)>(1);
+	executor->post([&](int) {
+		while (!queued) {
+			Util::sleepInMs(1);
+		}
+		delete executor;
+		numCalls++;
+	}, 0);
+	executor->post([&](int) {
+		numCalls++;
+	}, 0);
+	queued = true;
+	for (int i = 0; i < 1000 && numCalls < 2; ++i) {
+		Util::sleepInMs(1);
+	}
+	ASSERT(numCalls == 2);
+}
+}
@@ -35,5 +35,37 @@ unittest("basic module connection tests") {
 	ASSERT(res->size() == 5);
 	ASSERT((*res)[0] == 101 && (*res)[4] == 101);
 }
+
+class Processor {
+	public:
+		void process() {
+			numProcessed++;
+		}
+		int numProcessed = 0;
+};
+
+unittest("module-like dispatch: allocations per frame") {
+	typedef std::shared_ptr<const int> Data;
+	ExecutorSync<void(Data)> executor;
+	ExecutorSync<void()> processExecutorSync;
+	IExecutor<void()> *processExecutor = &processExecutorSync;
+	Signal<void(Data), ResultVector<void>> sig(executor);
+	Processor processor;
+	sig.connect([&processor, processExecutor](Data) {
+		processExecutor->post(MEMBER_FUNCTOR(&processor, &Processor::process));
+	});
+	auto const data = std::make_shared<const int>(0);
+	sig.emit(data);
+
+	const int numFrames = 1000;
+	auto const numAllocations = getNumAllocations();
+	for (int i = 0; i < numFrames; ++i) {
+		sig.emit(data);
+	}
+	auto const allocationsPerFrame = (getNumAllocations() - numAllocations) / (double)numFrames;
+	std::cout << allocationsPerFrame << " allocation(s) per frame" << std::endl;
+	ASSERT(allocationsPerFrame == 0);
+	ASSERT_EQUALS(numFrames + 1, processor.numProcessed);
+}
 }
 
@@ -1,7 +1,12 @@
 #include "tests.hpp"
 #include "lib_signals/signals.hpp"
 #include "lib_utils/profiler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <map>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 using namespace Tests;
@@ -50,6 +55,400 @@ void emitTest(std::function<SignalSignature> f, ValType val) {
 	}
 }
 
+void queueContentionTest(const std::string &name, IQueue<int> &queue, int numProducers, int numConsumers) {
+	const int numItems = 1 << 18;
+	std::stringstream ss;
+	ss << name << ": " << numProducers << " producer(s), " << numConsumers << " consumer(s), " << numItems << " items";
+	Tools::Profiler p(ss.str());
+	std::vector<std::thread> threads;
+	for (int i = 0; i < numProducers; ++i) {
+		threads.push_back(std::thread([&, i]() {
+			for (int j = i; j < numItems; j += numProducers) {
+				queue.push(j);
+			}
+		}));
+	}
+	for (int i = 0; i < numConsumers; ++i) {
+		threads.push_back(std::thread([&, i]() {
+			for (int j = i; j < numItems; j += numConsumers) {
+				queue.pop();
+			}
+		}));
+	}
+	for (auto &t : threads) {
+		t.join();
+	}
+}
+
+unittest("queue contention: locked vs lock-free") {
+	const int capacity = 1024;
+	{
+		Queue<int> queue;
+		queueContentionTest("Queue (locked)", queue, 1, 1);
+	}
+	{
+		QueueSPSC<int> queue(capacity);
+		queueContentionTest("QueueSPSC     ", queue, 1, 1);
+	}
+	{
+		QueueMPMC<int> queue(capacity);
+		queueContentionTest("QueueMPMC     ", queue, 1, 1);
+	}
+	for (int numThreads = 2; numThreads <= 8; numThreads *= 2) {
+		{
+			Queue<int> queue;
+			queueContentionTest("Queue (locked)", queue, numThreads, numThreads);
+		}
+		{
+			QueueMPMC<int> queue(capacity);
+			queueContentionTest("QueueMPMC     ", queue, numThreads, numThreads);
+		}
+	}
+}
+
+//reference layout before flat storage: a map of heap-allocated connections. Dispatches as Signal does: only the storage differs.
+struct MapConnections {
+	struct Connection {
+		IExecutor<void(int)> &executor;
+		std::shared_ptr<const std::function<void(int)>> const callback;
+		Connection(IExecutor<void(int)> &executor, const std::function<void(int)> &callback) : executor(executor), callback(std::make_shared<const std::function<void(int)>>(callback)) {}
+	};
+	~MapConnections() {
+		for (auto &c : connections)
+			delete c.second;
+	}
+	size_t connect(const std::function<void(int)> &cb, IExecutor<void(int)> &executor) {
+		connections[uid] = new Connection(executor, cb);
+		return uid++;
+	}
+	void emit(int val) {
+		for (auto &c : connections)
+			c.second->executor.postShared(c.second->callback, val);
+	}
+	std::map<size_t, Connection*> connections;
+	size_t uid = 0;
+};
+
+unittest("fan-out emit: flat connection storage vs map of heap-allocated connections") {
+	const int numEmits = 1 << 12;
+	ExecutorSync<void(int)> executor;
+	for (int numSlots = 1; numSlots <= 64; numSlots *= 4) {
+		int counter = 0;
+		auto slot = [&counter](int val) {
+			counter += val;
+		};
+		MapConnections mapConnections;
+		Signal<void(int), ResultVector<void>> sig(executor);
+		std::vector<Signal<void(int), ResultVector<void>>*> decoys; //interleave allocations as in a real graph
+		for (int i = 0; i < numSlots; ++i) {
+			mapConnections.connect(slot, executor);
+			sig.connect(slot);
+			decoys.push_back(new Signal<void(int), ResultVector<void>>(executor));
+		}
+		{
+			std::stringstream ss;
+			ss << "map  storage: " << numEmits << " emits to " << FORMAT(numSlots, 64) << " slots";
+			Tools::Profiler p(ss.str());
+			for (int i = 0; i < numEmits; ++i)
+				mapConnections.emit(1);
+		}
+		{
+			std::stringstream ss;
+			ss << "flat storage: " << numEmits << " emits to " << FORMAT(numSlots, 64) << " slots";
+			Tools::Profiler p(ss.str());
+			for (int i = 0; i < numEmits; ++i)
+				sig.emit(1);
+		}
+		ASSERT_EQUALS(2 * numEmits * numSlots, counter);
+		for (auto d : decoys)
+			delete d;
+	}
+}
+
+//ExecutorSync before the fire-and-forget path: every call creates a packaged_task and a future
+template<typename> class ExecutorSyncWithFuture;
+template<typename R, typename... Args>
+class ExecutorSyncWithFuture<R(Args...)> : public IExecutor<R(Args...)> {
+	public:
+		std::shared_future<NotVoid<R>> operator() (const std::function<R(Args...)> &fn, const Args&... args) {
+			std::packaged_task<NotVoid<R>(Args...)> task(NotVoidFunction(fn));
+			const std::shared_future<NotVoid<R>> &f = task.get_future();
+			task(args...);
+			return f;
+		}
+};
+
+template<template<typename> class ExecutorTemplate>
+void syncChainTest(const std::string &name) {
+	typedef std::shared_ptr<const int> Packet; //mimics Modules::Data
+	typedef Signal<void(Packet), ResultVector<NotVoid<void>>> ChainSignal; //mimics Modules::SignalSync
+	const int numStages = 5, numPackets = 1 << 16;
+	ExecutorTemplate<void(Packet)> executor;
+	std::vector<std::unique_ptr<ChainSignal>> stages;
+	for (int i = 0; i < numStages; ++i) {
+		stages.push_back(uptr(new ChainSignal(executor)));
+	}
+	int received = 0;
+	for (int i = 0; i < numStages - 1; ++i) {
+		auto next = stages[i + 1].get();
+		stages[i]->connect([next](Packet p) {
+			next->emit(p);
+		});
+	}
+	stages[numStages - 1]->connect([&received](Packet) {
+		received++;
+	});
+	auto const packet = std::make_shared<const int>(0);
+	{
+		Tools::Profiler p(name);
+		for (int i = 0; i < numPackets; ++i) {
+			stages[0]->emit(packet);
+		}
+		std::cout << "(" << numPackets << " packets) ";
+	}
+	ASSERT_EQUALS(numPackets, received);
+}
+
+unittest("5-stage sync chain: per-packet cost with futures vs fire-and-forget") {
+	syncChainTest<ExecutorSyncWithFuture>("5-stage sync chain with futures     ");
+	syncChainTest<ExecutorSync>          ("5-stage sync chain, fire-and-forget ");
+}
+
+template<template<typename> class ExecutorTemplate>
+void emitThroughputTest(const std::string &name, int numSlots) {
+	const int numEmits = 256;
+	std::atomic<int> numCalls(0);
+	std::stringstream ss;
+	ss << name << ": " << numEmits << " emits on " << FORMAT(numSlots, 64) << " connected callbacks";
+	{
+		Tools::Profiler p(ss.str());
+		ExecutorTemplate<void(int)> executor;
+		Signal<void(int)> sig(executor);
+		for (int i = 0; i < numSlots; ++i) {
+			sig.connect([&](int) {
+				numCalls++;
+			});
+		}
+		for (int i = 0; i < numEmits; ++i) {
+			sig.emit(i);
+		}
+	}
+	ASSERT(numCalls == numEmits * numSlots);
+}
+
+unittest("async emit throughput: thread per call vs bounded executor") {
+	for (int numSlots : { 1, 8, 64 }) {
+		emitThroughputTest<ExecutorAsync>  ("thread per call ", numSlots);
+		emitThroughputTest<ExecutorBounded>("bounded executor", numSlots);
+	}
+}
+
+template<template<typename> class ExecutorTemplate>
+void emitBatchTest(const std::string &name, size_t batchSize) {
+	const int numItems = 1 << 16;
+	std::atomic<int> numCalls(0);
+	std::vector<int> batch(batchSize);
+	std::stringstream ss;
+	ss << name << ": " << numItems << " items by batches of " << FORMAT(batchSize, 256);
+	{
+		Tools::Profiler p(ss.str());
+		ExecutorTemplate<void(int)> executor;
+		Signal<void(int)> sig(executor);
+		sig.connect([&](int) {
+			numCalls++;
+		});
+		for (int i = 0; i < numItems; i += (int)batchSize) {
+			if (batchSize == 1) {
+				sig.emit(i);
+			} else {
+				sig.emitBatch(batch);
+			}
+		}
+	}
+	ASSERT(numCalls == numItems);
+}
+
+unittest("emit vs emitBatch") {
+	for (size_t batchSize : { 1, 16, 256 }) {
+		emitBatchTest<ExecutorSync>   ("sync   ", batchSize);
+		emitBatchTest<ExecutorBounded>("bounded", batchSize);
+	}
+}
+
+//stands for Modules::Data (a refcounted pointer to const data)
+typedef std::shared_ptr<const uint64_t> Data;
+
+struct AccumulateSlot {
+	uint64_t *sum;
+	void operator()(Data data) const {
+		*sum += *data;
+	}
+};
+
+unittest("3 fixed connections: Signal<void(Data)> vs StaticSignal") {
+	const int numEmits = 1 << 20;
+	auto const data = std::make_shared<const uint64_t>(1);
+	uint64_t sum = 0;
+	{
+		ExecutorSync<void(Data)> executor;
+		Signal<void(Data), ResultVector<void>> sig(executor);
+		for (int i = 0; i < 3; ++i) {
+			sig.connect(AccumulateSlot { &sum });
+		}
+		Tools::Profiler p("Signal<void(Data)>, sync executor");
+		for (int i = 0; i < numEmits; ++i) {
+			sig.emit(data);
+		}
+	}
+	{
+		auto sig = makeStaticSignal(AccumulateSlot { &sum }, AccumulateSlot { &sum }, AccumulateSlot { &sum });
+		Tools::Profiler p("StaticSignal                     ");
+		for (int i = 0; i < numEmits; ++i) {
+			sig.emit(data);
+		}
+	}
+	{
+		Tools::Profiler p("direct calls                     ");
+		for (int i = 0; i < numEmits; ++i) {
+			for (int j = 0; j < 3; ++j) {
+				AccumulateSlot { &sum }(data);
+			}
+		}
+	}
+	ASSERT(sum == 3 * 3 * (uint64_t)numEmits);
+}
+
+//counts its copies: a copy of a shared_ptr is an atomic increment, and later a decrement
+std::atomic<uint64_t> g_numCopies(0);
+struct CopyCounted {
+	CopyCounted() {}
+	CopyCounted(const CopyCounted&) {
+		g_numCopies++;
+	}
+	CopyCounted(CopyCounted&&) {}
+	CopyCounted& operator= (const CopyCounted&) {
+		g_numCopies++;
+		return *this;
+	}
+	CopyCounted& operator= (CopyCounted&&) {
+		return *this;
+	}
+};
+
+template<template<typename> class ExecutorTemplate>
+void refcountTest(const std::string &name, int numSlots) {
+	const int numEmits = 1000;
+	{
+		ExecutorTemplate<void(CopyCounted)> executor;
+		Signal<void(CopyCounted), ResultVector<void>> sig(executor);
+		for (int i = 0; i < numSlots; ++i) {
+			sig.connect([](CopyCounted) {});
+		}
+		CopyCounted data;
+		g_numCopies = 0;
+		for (int i = 0; i < numEmits; ++i) {
+			sig.emit(data);
+		}
+	}
+	std::cout << name << ", " << numSlots << " slot(s): " << g_numCopies / (double)numEmits << " copies per emit" << std::endl;
+}
+
+unittest("refcount operations per emit") {
+	for (int numSlots : { 1, 4 }) {
+		refcountTest<ExecutorSync>   ("sync   ", numSlots);
+		refcountTest<ExecutorBounded>("bounded", numSlots);
+	}
+	const int numEmits = 1 << 20;
+	ExecutorSync<void(std::shared_ptr<const int>)> executor;
+	Signal<void(std::shared_ptr<const int>), ResultVector<void>> sig(executor);
+	for (int i = 0; i < 4; ++i) {
+		sig.connect([](std::shared_ptr<const int>) {});
+	}
+	auto const data = std::make_shared<const int>(0);
+	Tools::Profiler p("1M emits of a shared_ptr to 4 slots, sync executor");
+	for (int i = 0; i < numEmits; ++i) {
+		sig.emit(data);
+	}
+}
+
+//reference: the former thread pool, a single locked queue shared by all the workers
+class CentralQueuePool {
+	public:
+		CentralQueuePool(unsigned threadCount) {
+			for (unsigned i = 0; i < threadCount; ++i) {
+				threads.push_back(std::thread([this]() {
+					for (;;) {
+						auto task = workQueue.pop();
+						if (!task)
+							return;
+						task();
+					}
+				}));
+			}
+		}
+		void post(std::function<void(void)> task) {
+			workQueue.push(task);
+		}
+		void WaitForCompletion() {
+			while (numPending) {
+				std::this_thread::yield();
+			}
+			for (size_t i = 0; i < threads.size(); ++i) {
+				workQueue.push(nullptr);
+			}
+			for (auto &t : threads) {
+				t.join();
+			}
+		}
+		std::atomic<int> numPending{0};
+
+	private:
+		Queue<std::function<void(void)>> workQueue;
+		std::vector<std::thread> threads;
+};
+
+template<typename Pool>
+void forkJoinTest(const std::string &name, Pool &pool, std::atomic<int> &numPending) {
+	const int numRoots = 64, numChildren = 1024;
+	std::atomic<int> sum(0);
+	{
+		Tools::Profiler p(name);
+		numPending = numRoots * (numChildren + 1);
+		for (int i = 0; i < numRoots; ++i) {
+			pool.post([&]() {
+				for (int j = 0; j < numChildren; ++j) {
+					pool.post([&, j]() {
+						sum += Util::dummy(j);
+						numPending--;
+					});
+				}
+				numPending--;
+			});
+		}
+		pool.WaitForCompletion();
+	}
+	ASSERT(sum == numRoots * (numChildren * (numChildren - 1) / 2));
+}
+
+unittest("thread pool: fork-join with a central queue vs work-stealing") {
+	const unsigned numThreads = std::max(2u, std::thread::hardware_concurrency());
+	{
+		CentralQueuePool pool(numThreads);
+		forkJoinTest("central locked queue", pool, pool.numPending);
+	}
+	{
+		ThreadPool pool(numThreads);
+		std::atomic<int> numPending(0);
+		forkJoinTest("work-stealing       ", pool, numPending);
+		uint64_t numSteals = 0, idleTimeInUs = 0;
+		for (auto &s : pool.getStats()) {
+			numSteals += s.numSteals;
+			idleTimeInUs += s.idleTimeInUs;
+		}
+		std::cout << "work-stealing: " << numSteals << " steals, " << idleTimeInUs << "us idle (all workers)" << std::endl;
+	}
+}
+
 unittest("create a signal") {
 	{
 		Tools::Profiler p("Create void(void)");
@@ -1,5 +1,7 @@
 #include "tests.hpp"
 #include "lib_signals/signals.hpp"
+#include <atomic>
+#include <vector>
 
 using namespace Tests;
 using namespace Signals;
@@ -155,5 +157,116 @@ unittest("thread-safe queue can be destroyed while element is blocked while push
 	tf.join();
 }
 
+unittest("lock-free queues: FIFO order and bounded tryPush()") {
+	QueueSPSC<int> spsc(4);
+	QueueMPMC<int> mpmc(4);
+	for (int i = 0; i < 4; ++i) {
+		ASSERT(spsc.tryPush(i));
+		ASSERT(mpmc.tryPush(i));
+	}
+	ASSERT(!spsc.tryPush(4));
+	ASSERT(!mpmc.tryPush(4));
+	for (int i = 0; i < 4; ++i) {
+		ASSERT_EQUALS(i, spsc.pop());
+		ASSERT_EQUALS(i, mpmc.pop());
+	}
+	int val;
+	ASSERT(!spsc.tryPop(val));
+	ASSERT(!mpmc.tryPop(val));
+}
+
+unittest("lock-free queues: clear()") {
+	std::unique_ptr<IQueue<int>> spsc(createQueue<int>(QueueLockFreeSPSC, 8));
+	std::unique_ptr<IQueue<int>> mpmc(createQueue<int>(QueueLockFreeMPMC, 8));
+	for (int i = 0; i < 3; ++i) {
+		spsc->push(i);
+		mpmc->push(i);
+	}
+	spsc->clear();
+	mpmc->clear();
+	int val;
+	ASSERT(!spsc->tryPop(val));
+	ASSERT(!mpmc->tryPop(val));
+}
+
+unittest("lock-free SPSC queue: blocking pop() and push() across threads") {
+	const int numItems = 10000;
+	QueueSPSC<int> queue(16);
+	auto f = [&]() {
+		for (int i = 0; i < numItems; ++i) {
+			queue.push(i);
+		}
+	};
+	std::thread tf(f);
+	for (int i = 0; i < numItems; ++i) {
+		ASSERT_EQUALS(i, queue.pop());
+	}
+	tf.join();
+}
+
+unittest("lock-free MPMC queue: several producers and consumers") {
+	const int numThreads = 4, numItems = 10000;
+	QueueMPMC<int> queue(16);
+	std::atomic<int64_t> sum(0);
+	std::vector<std::thread> producers, consumers;
+	for (int t = 0; t < numThreads; ++t) {
+		producers.push_back(std::thread([&]() {
+			for (int i = 1; i <= numItems; ++i) {
+				queue.push(i);
+			}
+		}));
+		consumers.push_back(std::thread([&]() {
+			for (int i = 0; i < numItems; ++i) {
+				sum += queue.pop();
+			}
+		}));
+	}
+	for (int t = 0; t < numThreads; ++t) {
+		producers[t].join();
+		consumers[t].join();
+	}
+	ASSERT_EQUALS((int64_t)numThreads * numItems * (numItems + 1) / 2, sum);
 }
 
+unittest("queue: tryPopN() and popAll()") {
+	Queue<int> queue;
+	std::vector<int> values;
+	ASSERT_EQUALS(0, queue.tryPopN(values, 4));
+	for (int i = 0; i < 10; ++i) {
+		queue.push(i);
+	}
+	ASSERT_EQUALS(4, queue.tryPopN(values, 4));
+	ASSERT_EQUALS(6, queue.popAll(values));
+	ASSERT(values.size() == 10);
+	for (int i = 0; i < 10; ++i) {
+		ASSERT_EQUALS(i, values[i]);
+	}
+	ASSERT_EQUALS(0, queue.tryPopN(values, 4));
+}
+
+unittest("lock-free queues: tryPopN() and popAll()") {
+	std::unique_ptr<IQueue<int>> queue(createQueue<int>(QueueLockFreeMPMC, 16));
+	std::vector<int> values;
+	for (int i = 0; i < 10; ++i) {
+		queue->push(i);
+	}
+	ASSERT_EQUALS(3, queue->tryPopN(values, 3));
+	ASSERT_EQUALS(7, queue->popAll(values));
+	for (int i = 0; i < 10; ++i) {
+		ASSERT_EQUALS(i, values[i]);
+	}
+}
+
+unittest("popAll() waits for data") {
+	Queue<int> queue;
+	std::thread tf([&]() {
+		Util::sleepInMs(20);
+		queue.push(1789);
+	});
+	std::vector<int> values;
+	ASSERT_EQUALS(1, queue.popAll(values));
+	ASSERT_EQUALS(1789, values[0]);
+	tf.join();
+}
+
+}
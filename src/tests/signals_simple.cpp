@@ -1,5 +1,8 @@
 #include "tests.hpp"
 #include "lib_signals/signals.hpp"
+#include <atomic>
+#include <tuple>
+#include <vector>
 
 using namespace Tests;
 using namespace Signals;
@@ -71,6 +74,32 @@ unittest("signals_simple") {
 	}
 }
 
+unittest("disconnect in the middle and reuse of connection ids") {
+	Signal<int(int)> sig;
+	std::vector<size_t> ids;
+	for (int i = 0; i < 4; ++i) {
+		ids.push_back(sig.connect(Util::dummy));
+	}
+	ASSERT(sig.disconnect(ids[1]));
+	ASSERT(!sig.disconnect(ids[1]));
+	auto const newId = sig.connect(dummy2);
+	ASSERT(newId != ids[1]); //stale ids stay invalid even if their slot is reused
+	ASSERT(!sig.disconnect(ids[1]));
+	auto const numVal = sig.emit(100);
+	ASSERT_EQUALS(4u, numVal);
+	auto const val = sig.results();
+	ASSERT_EQUALS(4u, val->size());
+	int sum = 0;
+	for (size_t i = 0; i < val->size(); ++i)
+		sum += (*val)[i];
+	ASSERT_EQUALS(3 * Util::dummy(100) + dummy2(100), sum);
+	for (auto id : ids) {
+		sig.disconnect(id);
+	}
+	ASSERT(sig.disconnect(newId));
+	ASSERT_EQUALS(0u, sig.emit(100));
+}
+
 unittest("connect to lambda") {
 	Signal<int(int)> sig;
 	Connect(sig, [](int val) -> int { return val * val; });
@@ -79,5 +108,95 @@ unittest("connect to lambda") {
 	ASSERT(res->size() == 1);
 	ASSERT((*res)[0] == 64);
 }
+
+unittest("emitBatch: each connection receives the whole batch in order") {
+	ExecutorSync<void(int)> executor;
+	Signal<void(int), ResultVector<void>> sig(executor);
+	std::vector<int> received1, received2;
+	sig.connect([&](int a) {
+		received1.push_back(a);
+	});
+	sig.connect([&](int a) {
+		received2.push_back(a);
+	});
+	std::vector<int> batch = { 1, 2, 3, 4 };
+	ASSERT_EQUALS(2, sig.emitBatch(batch));
+	ASSERT(received1 == batch);
+	ASSERT(received2 == batch);
+}
+
+unittest("emitBatch: several arguments and results") {
+	Signal<int(int, int)> sig;
+	sig.connect([](int a, int b) {
+		return a + b;
+	});
+	std::vector<std::tuple<int, int>> batch = { std::make_tuple(1, 2), std::make_tuple(10, 20) };
+	sig.emitBatch(batch);
+	auto res = sig.results();
+	ASSERT(res->size() == 2);
+	ASSERT((*res)[0] == 3);
+	ASSERT((*res)[1] == 30);
+}
+
+unittest("emitBatch: asynchronous executor") {
+	std::atomic<int> sum(0);
+	{
+		Signal<void(int)> sig;
+		sig.connect([&](int a) {
+			sum += a;
+		});
+		std::vector<int> batch = { 1, 2, 3, 4 };
+		sig.emitBatch(batch);
+	}
+	ASSERT_EQUALS(10, sum);
+}
+
+unittest("static signal: slots are called in connection order") {
+	std::vector<int> received;
+	auto sig = makeStaticSignal([&](int a) {
+		received.push_back(a);
+	});
+	auto sig2 = sig.connect([&](int a) {
+		received.push_back(a * 10);
+	});
+	ASSERT_EQUALS(1, sig.emit(1));
+	ASSERT_EQUALS(2, sig2.emit(2));
+	ASSERT(received == std::vector<int>({ 1, 2, 20 }));
+}
+
+unittest("static signal: forwarding to a dynamic signal") {
+	ExecutorSync<void(int)> executor;
+	Signal<void(int), ResultVector<void>> dynamicSig(executor);
+	int sum = 0;
+	auto sig = makeStaticSignal(makeSignalSlot(dynamicSig));
+	sig.emit(1);
+	dynamicSig.connect([&](int a) {
+		sum += a;
+	});
+	sig.emit(2);
+	sig.emit(3);
+	ASSERT_EQUALS(5, sum);
+}
+
+unittest("inplace function: move-only callable, moves and destruction") {
+	auto counter = std::make_shared<int>(0);
+	{
+		std::unique_ptr<int> moveOnly(new int(27));
+		InplaceFunction<int(int)> f([p = std::move(moveOnly), counter](int a) {
+			(*counter)++;
+			return *p + a;
+		});
+		ASSERT(f);
+		ASSERT_EQUALS(2, counter.use_count());
+		ASSERT_EQUALS(28, f(1));
+		InplaceFunction<int(int)> g(std::move(f));
+		ASSERT(!f);
+		ASSERT_EQUALS(2, counter.use_count());
+		ASSERT_EQUALS(29, g(2));
+		g = nullptr;
+		ASSERT_EQUALS(1, counter.use_count());
+	}
+	ASSERT_EQUALS(2, *counter);
+}
 }
 
@@ -1,4 +1,6 @@
+#include <atomic>
 #include <iostream>
+#include <new>
 #include <stdexcept>
 #include <stdlib.h>
 #include "lib_utils/profiler.hpp"
@@ -15,6 +17,23 @@ struct UnitTest {
 
 UnitTest g_AllTests[65536];
 int g_NumTests;
+
+std::atomic<uint64_t> g_NumAllocations(0);
+}
+
+void* operator new(size_t size) {
+	g_NumAllocations++;
+	if (auto p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+	free(p);
 }
 
 namespace Tests {
@@ -35,6 +54,10 @@ void Run(int i) {
 	std::cout << std::endl;
 }
 
+uint64_t getNumAllocations() {
+	return g_NumAllocations;
+}
+
 void RunAll() {
 	for(int i=0; i < g_NumTests; ++i) {
 		Run(i);
@@ -65,6 +65,9 @@ inline void Fail(char const* file, int line, const char* msg) {
 int RegisterTest(void (*f)(), const char* testName, int& dummy);
 void RunAll();
 
+/* number of calls to the global operator new since the start of the program */
+uint64_t getNumAllocations();
+
 inline void Test(const std::string &name) {
 	std::cout << std::endl << "[ ***** " << name.c_str() << " ***** ]" << std::endl;
 }
@@ -1,7 +1,11 @@
 #include "tests.hpp"
 
+#include "lib_utils/histogram.hpp"
 #include "lib_utils/tools.hpp"
 #include "lib_utils/log.hpp"
+#include "lib_utils/profiler.hpp"
+#include <ostream>
+#include <thread>
 
 using namespace Tests;
 
@@ -69,4 +73,167 @@ unittest("stringDup") {
 	ASSERT(!memcmp(s.data(), c, s.size()));
 }
 
+unittest("histogram: percentiles") {
+	Histogram histogram;
+	ASSERT_EQUALS(0u, histogram.getPercentile(50));
+	for (uint64_t i = 1; i <= 1000; ++i)
+		histogram.record(i * 1000);
+	ASSERT_EQUALS(1000u, histogram.getCount());
+	ASSERT_EQUALS(1000000u, histogram.getMax());
+	ASSERT_EQUALS(500500000u, histogram.getSum());
+	auto const p50 = histogram.getPercentile(50), p99 = histogram.getPercentile(99);
+	ASSERT(p50 >= 500000 && p50 <= 500000 * 33 / 32);
+	ASSERT(p99 >= 990000 && p99 <= 990000 * 33 / 32);
+	ASSERT_EQUALS(1000000u, histogram.getPercentile(100));
+}
+
+unittest("histogram: relative error below 1/32") {
+	for (uint64_t value = 1; value < 1000000000; value = value * 17 / 16 + 1) {
+		Histogram histogram;
+		histogram.record(value);
+		histogram.record(UINT64_MAX);
+		auto const p50 = histogram.getPercentile(50);
+		ASSERT(p50 >= value && p50 <= value + value / 32);
+	}
+}
+
+unittest("histogram: small values are exact") {
+	Histogram histogram;
+	for (uint64_t i = 0; i < 10; ++i)
+		histogram.record(i);
+	ASSERT_EQUALS(4u, histogram.getPercentile(50));
+	ASSERT_EQUALS(9u, histogram.getPercentile(99));
+	histogram.record(UINT64_MAX);
+	ASSERT_EQUALS(UINT64_MAX, histogram.getPercentile(100));
+	histogram.reset();
+	ASSERT_EQUALS(0u, histogram.getCount());
+}
+
+/* counts its formatting */
+struct Formatted {
+	int *numFormats;
+};
+
+std::ostream& operator<<(std::ostream &out, const Formatted &f) {
+	(*f.numFormats)++;
+	return out << "formatted";
+}
+
+unittest("log: disabled levels don't format their arguments") {
+	int numFormats = 0;
+	auto const level = Log::getLevel();
+	Log::setLevel(Warning);
+	Log::msg(Info, "not formatted: %s", Formatted{ &numFormats });
+	Log::flush();
+	ASSERT_EQUALS(0, numFormats);
+	Log::msg(Warning, "log test: %s", Formatted{ &numFormats });
+	Log::flush();
+	ASSERT_EQUALS(1, numFormats);
+	Log::setLevel(level);
+}
+
+unittest("log: errors are written before msg() returns") {
+	int numFormats = 0;
+	Log::msg(Error, "log test, not an error: %s", Formatted{ &numFormats });
+	ASSERT_EQUALS(1, numFormats);
+}
+
+/* records the thread formatting it */
+struct FormattingThread {
+	std::thread::id *id;
+};
+
+std::ostream& operator<<(std::ostream &out, const FormattingThread &f) {
+	*f.id = std::this_thread::get_id();
+	return out << "formatted";
+}
+
+unittest("log: messages too large for a slot are formatted by the background thread") {
+	std::thread::id formattingThread;
+	std::string const arg("large");
+	Log::msg(Info, "log test: %s %s %s %s %s %s", arg, arg, arg, arg, arg, FormattingThread{ &formattingThread });
+	Log::flush();
+	ASSERT(formattingThread != std::thread::id());
+	ASSERT(formattingThread != std::this_thread::get_id());
+}
+
+unittest("log: C string arguments are copied") {
+	auto output = tmpfile();
+	ASSERT(output);
+	Log::setOutput(output);
+	auto buffer = new char[16];
+	strcpy(buffer, "copied");
+	Log::msg(Info, "log test: %s", buffer);
+	strcpy(buffer, "overwritten");
+	delete[] buffer;
+	Log::flush();
+	Log::setOutput(nullptr);
+
+	char line[256] = {};
+	rewind(output);
+	auto const size = fread(line, 1, sizeof(line) - 1, output);
+	fclose(output);
+	ASSERT(size > 0);
+	ASSERT(strstr(line, "log test: copied"));
+}
+
+unittest("format: integer limits, floats and escapes") {
+	ASSERT_EQUALS("-9223372036854775808 18446744073709551615", format("%s %s", INT64_MIN, UINT64_MAX));
+	ASSERT_EQUALS("0.5 1e+20 1", format("%s %s %s", 0.5, 1e20, true));
+	ASSERT_EQUALS("100% 1 %d", format("100%% %s %d", 1));
+	ASSERT_EQUALS("no argument: %%", format("no argument: %%"));
+	ASSERT_EQUALS("1 %s", format(std::string("%s %s"), 1));
+}
+
+/* the previous engine: one stream per argument, a recursion and a substring per '%s' */
+template<typename T>
+std::string toStringWithStream(T const& val) {
+	std::stringstream ss;
+	ss << val;
+	return ss.str();
+}
+
+inline std::string formatWithStream(const std::string& format) {
+	return format;
+}
+
+template<typename T, typename... Arguments>
+std::string formatWithStream(const std::string& fmt, const T& firstArg, Arguments... args) {
+	std::string r;
+	size_t i = 0;
+	while (i < fmt.size()) {
+		if (fmt[i] == '%') {
+			++i;
+			if (fmt[i] == '%')
+				r += '%';
+			else if (fmt[i] == 's') {
+				r += toStringWithStream(firstArg);
+				return r + formatWithStream(fmt.substr(i + 1), args...);
+			}
+		} else {
+			r += fmt[i];
+		}
+		++i;
+	}
+	return r;
+}
+
+unittest("format: benchmark against the stream-based engine") {
+	const int numIter = 100000;
+	auto const expected = formatWithStream("Module %s: dispatch data for time %s (%s bytes)", "Modules::Out::File", 12.04, 1024);
+	ASSERT_EQUALS(expected, format("Module %s: dispatch data for time %s (%s bytes)", "Modules::Out::File", 12.04, 1024));
+	size_t total = 0;
+	{
+		Tools::Profiler p("format with streams");
+		for (int i = 0; i < numIter; ++i)
+			total += formatWithStream("Module %s: dispatch data for time %s (%s bytes)", "Modules::Out::File", i / 25.0, i).size();
+	}
+	{
+		Tools::Profiler p("format");
+		for (int i = 0; i < numIter; ++i)
+			total -= format("Module %s: dispatch data for time %s (%s bytes)", "Modules::Out::File", i / 25.0, i).size();
+	}
+	ASSERT_EQUALS(0u, total);
+}
+
 }